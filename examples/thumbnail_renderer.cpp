@@ -0,0 +1,47 @@
+#include "../include/ThumbnailRenderer.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+// Renders PNG thumbnails for every Document2D JSON file below a directory.
+// Usage: thumbnail_renderer <documents-directory> <cache-directory> [size]
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <documents-directory> <cache-directory> [size]\n";
+        return 1;
+    }
+    
+    ThumbnailOptions options;
+    if (argc > 3) {
+        options.size = std::atoi(argv[3]);
+        if (options.size <= 0) {
+            std::cerr << "Invalid size: " << argv[3] << "\n";
+            return 1;
+        }
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    ThumbnailRenderer renderer(argv[2], options);
+    std::vector<ThumbnailResult> results = renderer.renderDirectory(argv[1]);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    size_t rendered = 0, cached = 0, failed = 0;
+    for (const ThumbnailResult& result : results) {
+        switch (result.status) {
+            case ThumbnailStatus::RENDERED:
+                rendered++;
+                std::cout << "rendered " << result.document_path << " (" << result.points << " points)\n";
+                break;
+            case ThumbnailStatus::CACHED:
+                cached++;
+                break;
+            case ThumbnailStatus::FAILED:
+                failed++;
+                std::cerr << "failed " << result.document_path << "\n";
+                break;
+        }
+    }
+    std::cout << results.size() << " documents: " << rendered << " rendered, " << cached << " cached, "
+              << failed << " failed in " << seconds << " s\n";
+    return failed == 0 ? 0 : 2;
+}
@@ -4,6 +4,10 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <map>
+#include <functional>
+
+class HistoryJournal;
 
 class ConstructionStep {
 public:
@@ -19,8 +23,32 @@ private:
     void* data_;
 };
 
+// Immutable node of the history tree. Nodes only point to their parent,
+// so every branch shares the common prefix with the branch it forked from.
+class HistoryNode {
+public:
+    HistoryNode(std::shared_ptr<const HistoryNode> parent, std::unique_ptr<ConstructionStep> step);
+    ~HistoryNode();
+    
+    const HistoryNode* getParent() const { return parent_.get(); }
+    const std::shared_ptr<const HistoryNode>& getParentPtr() const { return parent_; }
+    ConstructionStep* getStep() const { return step_.get(); }
+    size_t getDepth() const { return depth_; }
+    
+private:
+    std::shared_ptr<const HistoryNode> parent_;  // Only released by the destructor
+    const std::unique_ptr<ConstructionStep> step_;
+    const size_t depth_;
+};
+
 class ConstructionHistory {
 public:
+    // Called for every step the cursor moves over (undo/redo/branch switch)
+    using StepHandler = std::function<void(ConstructionStep& step)>;
+    // Step data to journal bytes and back
+    using StepEncoder = std::function<std::string(const ConstructionStep& step)>;
+    using StepDecoder = std::function<void*(const std::string& operation, const std::string& bytes)>;
+    
     ConstructionHistory();
     virtual ~ConstructionHistory() = default;
     
@@ -29,17 +57,62 @@ public:
     void redo();
     void clear();
     
-    size_t getStepCount() const { return steps_.size(); }
+    size_t getStepCount() const { return path_.size(); }
     size_t getCurrentStepIndex() const { return current_step_index_; }
     ConstructionStep* getStep(size_t index) const;
     
     bool canUndo() const { return current_step_index_ > 0; }
-    bool canRedo() const { return current_step_index_ < steps_.size(); }
+    bool canRedo() const { return current_step_index_ < path_.size(); }
+    
+    // Branch management
+    bool createBranch(const std::string& name);
+    bool switchToBranch(const std::string& name);
+    bool removeBranch(const std::string& name);
+    bool hasBranch(const std::string& name) const;
+    std::vector<std::string> getBranchNames() const;
+    std::string getCurrentBranch() const { return current_branch_; }
+    size_t getBranchStepCount(const std::string& name) const;
+    size_t getCommonStepCount(const std::string& first, const std::string& second) const;
+    
+    // Replay handlers, used to revert/apply steps when the cursor moves
+    void setReplayHandlers(StepHandler revert, StepHandler apply);
+    
+    // Step data codec for the journal. Without one only operation names are
+    // journaled and recovered steps carry no data.
+    void setStepCodec(StepEncoder encode, StepDecoder decode);
+    
+    // Re-adds a journaled step, decoding its data, and applies it like a redo
+    void recoverStep(const std::string& operation, const std::string& bytes);
+    
+    // Write-ahead journal, shared with the document that opened it; every
+    // history operation is appended to it under the stream name while it is open
+    void setJournal(std::shared_ptr<HistoryJournal> journal, const std::string& stream = "") {
+        journal_ = std::move(journal);
+        journal_stream_ = stream;
+    }
+    const std::shared_ptr<HistoryJournal>& getJournal() const { return journal_; }
+    const std::string& getJournalStream() const { return journal_stream_; }
+    
+    // Journals the rename, so recovery under the new name also finds the
+    // records written under the old one
+    void renameJournalStream(const std::string& stream);
     
 private:
-    std::vector<std::unique_ptr<ConstructionStep>> steps_;
+    std::vector<std::shared_ptr<const HistoryNode>> path_;  // Root to tip of the current branch
     size_t current_step_index_;
+    std::map<std::string, std::shared_ptr<const HistoryNode>> branches_;  // Branch tips
+    std::string current_branch_;
+    size_t next_branch_id_;
+    StepHandler revert_handler_;
+    StepHandler apply_handler_;
+    StepEncoder step_encoder_;
+    StepDecoder step_decoder_;
+    std::shared_ptr<HistoryJournal> journal_;
+    std::string journal_stream_;
+    
+    std::string makeBranchName();
+    void moveCursorTo(size_t index);
+    static const HistoryNode* commonAncestor(const HistoryNode* a, const HistoryNode* b);
 };
 
 #endif // CONSTRUCTION_HISTORY_H
-
@@ -0,0 +1,107 @@
+#ifndef CULLING_STAGE_H
+#define CULLING_STAGE_H
+
+#include "OpenGLRenderer.h"
+#include "PointStore.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// projection * model-view, column-major like the renderer's matrices.
+// Built once per frame or draw by every stage that projects geometry.
+struct ClipTransform {
+    float mvp[16];
+    
+    ClipTransform(const float* projection, const float* model_view);
+    // Column-major out = a * b
+    static void multiply(const float* a, const float* b, float* out);
+    // Larger side, in pixels, of the screen rectangle of a rectangle in the
+    // z = 0 plane; unbounded if a corner is behind the eye
+    float projectedExtent(double min_x, double min_y, double max_x, double max_y, int width, int height) const;
+};
+
+// Clip-space planes of projection * model-view, pointing inwards
+struct Frustum {
+    float planes[6][4];
+    
+    static Frustum fromMatrices(const float* projection, const float* model_view);
+    static Frustum fromTransform(const ClipTransform& transform);
+    bool intersectsBox(float min_x, float min_y, float min_z, float max_x, float max_y, float max_z) const;
+    bool containsBox(float min_x, float min_y, float min_z, float max_x, float max_y, float max_z) const;
+    bool containsPoint(float x, float y, float z) const {
+        for (const float* plane : planes) {
+            if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct CullStats {
+    size_t chunks_tested = 0;
+    size_t chunks_culled = 0;     // Outside the frustum
+    size_t chunks_decimated = 0;  // Drawn with a LOD representative set
+    size_t points_visible = 0;    // Live points of the chunks that passed
+    size_t points_submitted = 0;
+};
+
+// Stage between a point store and OpenGLRenderer::drawPoints. Chunks whose
+// bounds miss the renderer's frustum are skipped; chunks whose points are
+// denser on screen than the allowed error are replaced by a grid-decimated
+// representative set, built once per chunk version and cached. Points of
+// chunks straddling the frustum are tested one by one, since chunks follow
+// insertion order and can span the whole drawing.
+// Use one stage per store: cache entries of chunks not seen by the last
+// cull() are dropped.
+class CullingStage {
+public:
+    // Representative grids per chunk: 4x4, 16x16 and 64x64 cells
+    static const int LOD_LEVELS = 3;
+    static const int LOD_BASE_RESOLUTION = 4;
+    
+    CullingStage();
+    
+    // Largest screen distance, in pixels, between a point and its representative
+    void setMaxScreenError(float pixels) { max_screen_error_ = pixels > 0.0f ? pixels : 0.0f; }
+    float getMaxScreenError() const { return max_screen_error_; }
+    void setPointColor(float r, float g, float b, float a = 1.0f);
+    
+    // Vertices to draw for the renderer's current matrices and viewport,
+    // valid until the next cull()
+    const std::vector<Vertex3D>& cull(const PointStore& points, const OpenGLRenderer& renderer);
+    void draw(const PointStore& points, OpenGLRenderer& renderer);
+    
+    const CullStats& getStats() const { return stats_; }
+    size_t getCachedChunkCount() const { return lods_.size(); }
+    void clearCache() { lods_.clear(); }
+    
+private:
+    struct ChunkLod {
+        uint64_t version = 0;
+        uint64_t last_cull = 0;
+        bool built = false;
+        std::vector<float> levels[LOD_LEVELS];  // x, y pairs
+    };
+    
+    struct Selection {
+        const PointChunk* chunk;
+        ChunkLod* lod;  // Null when drawn at full detail
+        int level;
+        size_t first_vertex;
+        size_t vertex_count;  // Written, at most the reserved upper bound
+        bool inside;          // Bounds entirely within the frustum, no per-point test
+    };
+    
+    float max_screen_error_;
+    Vertex3D color_;
+    CullStats stats_;
+    uint64_t cull_count_;
+    std::unordered_map<const PointChunk*, ChunkLod> lods_;
+    std::vector<Selection> selections_;
+    std::vector<Vertex3D> vertices_;
+    
+    static void buildLod(const PointChunk& chunk, ChunkLod& lod);
+};
+
+#endif // CULLING_STAGE_H
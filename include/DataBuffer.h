@@ -0,0 +1,67 @@
+#ifndef DATA_BUFFER_H
+#define DATA_BUFFER_H
+
+#include <string>
+#include <memory>
+#include <typeinfo>
+#include <cstdint>
+
+// Integer identifier of a registered data type (0 means unknown)
+using DataTypeId = uint32_t;
+
+// Process-wide registry mapping data type names to dense integer ids.
+// Types are registered once, lookups on the exchange path use the id only.
+class DataTypeRegistry {
+public:
+    static const DataTypeId INVALID_TYPE = 0;
+    
+    static DataTypeId registerType(const std::string& name);
+    static DataTypeId findType(const std::string& name);
+    static std::string getTypeName(DataTypeId id);
+    static size_t getTypeCount();
+};
+
+// Reference-counted immutable payload exchanged between solutions.
+// Copying a buffer only bumps the reference count, the payload is never copied.
+class DataBuffer {
+public:
+    DataBuffer() : type_(DataTypeRegistry::INVALID_TYPE), payload_type_(nullptr), count_(0) {}
+    
+    template<typename T>
+    static DataBuffer make(DataTypeId type, std::shared_ptr<const T> payload, size_t count = 1) {
+        DataBuffer buffer;
+        buffer.type_ = type;
+        buffer.payload_type_ = &typeid(T);
+        buffer.count_ = payload ? count : 0;
+        buffer.payload_ = std::move(payload);
+        return buffer;
+    }
+    
+    template<typename T>
+    static DataBuffer make(DataTypeId type, T value) {
+        return make<T>(type, std::make_shared<const T>(std::move(value)));
+    }
+    
+    bool isValid() const { return type_ != DataTypeRegistry::INVALID_TYPE && payload_ != nullptr; }
+    DataTypeId getType() const { return type_; }
+    size_t getCount() const { return count_; }
+    const void* data() const { return payload_.get(); }
+    long useCount() const { return payload_.use_count(); }
+    
+    // Typed view of the payload, nullptr if the payload holds another C++ type
+    template<typename T>
+    const T* as() const {
+        if (!payload_type_ || (payload_type_ != &typeid(T) && *payload_type_ != typeid(T))) {
+            return nullptr;
+        }
+        return static_cast<const T*>(payload_.get());
+    }
+    
+private:
+    DataTypeId type_;
+    const std::type_info* payload_type_;
+    size_t count_;
+    std::shared_ptr<const void> payload_;
+};
+
+#endif // DATA_BUFFER_H
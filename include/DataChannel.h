@@ -0,0 +1,43 @@
+#ifndef DATA_CHANNEL_H
+#define DATA_CHANNEL_H
+
+#include "DataBuffer.h"
+#include <string>
+#include <future>
+
+class Solution;
+class DataExchange;
+
+// Typed connection between two solutions for one data type.
+// Capabilities and the target's DataExchange are resolved once on
+// construction, so transfers skip the per-call validation and lookups.
+class DataChannel {
+public:
+    DataChannel(Solution* source, Solution* target, DataTypeId type);
+    DataChannel(Solution* source, Solution* target, const std::string& data_type);
+    virtual ~DataChannel() = default;
+    
+    bool isValid() const { return valid_; }
+    DataTypeId getType() const { return type_; }
+    Solution* getSource() const { return source_; }
+    Solution* getTarget() const { return target_; }
+    
+    // Pull a buffer from the source and hand it to the target
+    DataBuffer transfer();
+    
+    // Hand an already built buffer to the target
+    DataBuffer send(const DataBuffer& buffer);
+    
+    // Asynchronous variants, delivered through the target's inbox
+    std::future<DataBuffer> transferAsync();
+    std::future<DataBuffer> sendAsync(const DataBuffer& buffer);
+    
+private:
+    Solution* source_;
+    Solution* target_;
+    DataTypeId type_;
+    DataExchange* exchange_;
+    bool valid_;
+};
+
+#endif // DATA_CHANNEL_H
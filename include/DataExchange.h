@@ -1,6 +1,7 @@
 #ifndef DATA_EXCHANGE_H
 #define DATA_EXCHANGE_H
 
+#include "DataBuffer.h"
 #include <string>
 #include <vector>
 #include <memory>
@@ -15,9 +16,15 @@ public:
     virtual void* processData(void* data, const std::string& data_type) = 0;
     virtual std::vector<std::string> getSupportedDataTypes() const = 0;
     
+    // Typed path, buffers are shared and must not be modified
+    virtual DataBuffer processBuffer(const DataBuffer& buffer) { return buffer; }
+    
     virtual void setSourceSolution(Solution* solution) { source_solution_ = solution; }
     virtual void setTargetSolution(Solution* solution) { target_solution_ = solution; }
     
+    Solution* getSourceSolution() const { return source_solution_; }
+    Solution* getTargetSolution() const { return target_solution_; }
+    
 protected:
     Solution* source_solution_ = nullptr;
     Solution* target_solution_ = nullptr;
@@ -35,8 +42,15 @@ public:
     virtual void registerDataExchange(DataExchange* exchange);
     virtual std::vector<DataExchange*> getDataExchanges() const { return data_exchanges_; }
     
+    // Flat dispatch table lookup by registered type id
+    DataExchange* findDataExchange(DataTypeId type) const {
+        return type < dispatch_table_.size() ? dispatch_table_[type] : nullptr;
+    }
+    DataExchange* findDataExchange(const std::string& data_type) const;
+    
 private:
     std::vector<DataExchange*> data_exchanges_;
+    std::vector<DataExchange*> dispatch_table_;
 };
 
 #endif // DATA_EXCHANGE_H
@@ -3,9 +3,12 @@
 
 #include "SolutionDocument.h"
 #include "2D_point.h"
+#include "PointStore.h"
 #include <vector>
 #include <memory>
 #include <string>
+#include <span>
+#include <functional>
 
 class Document2D : public SolutionDocument {
 public:
@@ -32,17 +35,48 @@ public:
     virtual std::vector<std::string> getSupportedImportFormats() const override;
     virtual std::vector<std::string> getSupportedExportFormats() const override;
     
-    // 2D specific methods
+    // 2D specific methods. Copies of the document share point storage;
+    // getPoint() and getAllPoints() only read it, editPoint() detaches the
+    // touched chunk and editAllPoints() every chunk.
+    // removePoint() only tombstones the point, storage is compacted in the
+    // background once enough points were removed.
     void addPoint(const Point2D& point);
     void addPoint(double x, double y);
+    size_t addPoints(std::span<const double> xs, std::span<const double> ys);
+    void reservePoints(size_t count) { points_.reserve(count); }
     void removePoint(size_t index);
-    Point2D* getPoint(size_t index);
+    size_t removePoints(const std::vector<bool>& selected);
+    size_t removePoints(const std::vector<size_t>& indices);
+    void compactPoints() { points_.compact(); }
     const Point2D* getPoint(size_t index) const;
+    Point2D* editPoint(size_t index);
     size_t getPointCount() const { return points_.size(); }
+    const PointStore& getPointStore() const { return points_; }
     void clearPoints();
     
-    std::vector<Point2D*> getAllPoints();
     std::vector<const Point2D*> getAllPoints() const;
+    std::vector<Point2D*> editAllPoints();
+    
+    // Groups point edits: modification state and the change notification
+    // are committed once when the outermost batch ends
+    class BatchEdit {
+    public:
+        explicit BatchEdit(Document2D& document) : document_(document) { document_.beginBatch(); }
+        ~BatchEdit() { document_.endBatch(); }
+        
+        BatchEdit(const BatchEdit&) = delete;
+        BatchEdit& operator=(const BatchEdit&) = delete;
+    
+    private:
+        Document2D& document_;
+    };
+    
+    void beginBatch();
+    void endBatch();
+    bool isInBatch() const { return batch_depth_ > 0; }
+    
+    // Called once per committed point change (per edit or per batch)
+    void setOnPointsChanged(std::function<void()> callback) { on_points_changed_ = std::move(callback); }
     
     // Coordinate system management
     void setDefaultCoordinateSystem(CS* cs);
@@ -60,11 +94,16 @@ public:
     double getScale() const { return scale_; }
     
 protected:
-    std::vector<std::unique_ptr<Point2D>> points_;
+    PointStore points_;
     CS* default_cs_;
     std::string units_;
     double scale_;
     bool is_open_;
+    int batch_depth_;
+    bool batch_changed_;
+    std::function<void()> on_points_changed_;
+    
+    void notifyPointsChanged();
     
     // Helper methods
     bool detectFileFormat(const std::string& file_path, std::string& format) const;
@@ -0,0 +1,134 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "ValueData.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class Value;
+class Node;
+
+// Formula over Values, e.g. "(a + b) * 2 / c".
+// parse() builds a syntax tree, compile() type-checks it against the
+// current operand types, folds constants and emits a flat register program
+// specialized to int/double operations. evaluate() runs that program and
+// only recompiles when a bound operand changes type.
+// Nesting (parentheses, signs and operator chains) is limited to MAX_DEPTH
+// levels so that no stage can run out of stack.
+class Expression {
+public:
+    struct SyntaxNode;  // Defined in Expression.cpp
+    
+    static const size_t MAX_DEPTH = 512;
+    
+    Expression();
+    explicit Expression(const std::string& source);
+    virtual ~Expression();
+    
+    bool parse(const std::string& source);
+    std::string getSource() const { return source_; }
+    std::string getError() const { return error_; }
+    
+    // Variable binding, bound objects must outlive the expression
+    bool bind(const std::string& name, const Value* value);
+    bool bind(const std::string& name, const ValueData* data);
+    // Only ports added with addValueInput/addValueOutput can be bound
+    bool bindNodePort(const std::string& name, Node* node, const std::string& port);
+    std::vector<std::string> getVariableNames() const;
+    bool isBound() const;
+    
+    bool compile();
+    bool isCompiled() const { return compiled_; }
+    bool isConstant() const;
+    // INTEGER or DOUBLE for specialized programs, otherwise the folded
+    // constant's type or UNDEFINED when only known at evaluation time
+    ValueData::Type getResultType() const { return result_type_; }
+    size_t getInstructionCount() const { return program_.size(); }
+    
+    ValueData evaluate();
+    
+private:
+    enum class RegisterClass : uint8_t {
+        INTEGER,
+        DOUBLE,
+        GENERIC
+    };
+    
+    enum class OpCode : uint8_t {
+        LOAD_INT,
+        LOAD_DOUBLE,
+        LOAD_INT_AS_DOUBLE,
+        LOAD_GENERIC,
+        INT_TO_DOUBLE,
+        INT_TO_GENERIC,
+        DOUBLE_TO_GENERIC,
+        ADD_INT,
+        SUBTRACT_INT,
+        MULTIPLY_INT,
+        DIVIDE_INT,
+        ADD_DOUBLE,
+        SUBTRACT_DOUBLE,
+        MULTIPLY_DOUBLE,
+        DIVIDE_DOUBLE,
+        ADD_GENERIC,
+        SUBTRACT_GENERIC,
+        MULTIPLY_GENERIC,
+        DIVIDE_GENERIC
+    };
+    
+    struct Instruction {
+        OpCode op;
+        uint32_t target;
+        uint32_t left;
+        uint32_t right;
+    };
+    
+    struct Variable {
+        std::string name;
+        const ValueData* data = nullptr;
+        ValueData::Type compiled_type = ValueData::Type::UNDEFINED;
+    };
+    
+    struct Operand {
+        RegisterClass register_class;
+        uint32_t index;
+    };
+    
+    std::string source_;
+    std::string error_;
+    std::unique_ptr<SyntaxNode> root_;
+    std::vector<Variable> variables_;
+    size_t parse_depth_;
+    
+    // Compiled program
+    bool compiled_;
+    std::unique_ptr<SyntaxNode> folded_;
+    std::vector<Instruction> program_;
+    std::vector<int> int_registers_;
+    std::vector<double> double_registers_;
+    std::vector<ValueData> generic_registers_;
+    Operand result_;
+    ValueData::Type result_type_;
+    
+    // Parsing
+    std::unique_ptr<SyntaxNode> parseSum(const std::string& text, size_t& pos);
+    std::unique_ptr<SyntaxNode> parseProduct(const std::string& text, size_t& pos);
+    std::unique_ptr<SyntaxNode> parseUnary(const std::string& text, size_t& pos);
+    std::unique_ptr<SyntaxNode> parsePrimary(const std::string& text, size_t& pos);
+    size_t findOrAddVariable(const std::string& name);
+    
+    // Compilation
+    std::unique_ptr<SyntaxNode> fold(const SyntaxNode& node) const;
+    RegisterClass classify(const SyntaxNode& node) const;
+    Operand emit(const SyntaxNode& node, RegisterClass target);
+    Operand convert(Operand operand, RegisterClass target);
+    uint32_t allocate(RegisterClass register_class);
+    
+    ValueData evaluateTree(const SyntaxNode& node) const;
+    ValueData readResult() const;
+    bool typesChanged() const;
+};
+
+#endif // EXPRESSION_H
@@ -0,0 +1,95 @@
+#ifndef HISTORY_JOURNAL_H
+#define HISTORY_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+class ConstructionHistory;
+
+// Append-only binary journal of construction history operations.
+// Records are buffered in memory and written by a background thread that
+// fsyncs once per batch (group commit), so append() never waits for disk.
+// Every record is tagged with a stream name, so several histories can share
+// one journal. Step data is written as the bytes the history's step codec
+// produces; without a codec only operation names are journaled.
+class HistoryJournal {
+public:
+    enum class RecordType : uint8_t {
+        ADD_STEP = 1,
+        UNDO = 2,
+        REDO = 3,
+        CREATE_BRANCH = 4,
+        SWITCH_BRANCH = 5,
+        REMOVE_BRANCH = 6,
+        CLEAR = 7,
+        RENAME_STREAM = 8  // Later records of the stream use the text as its name
+    };
+    
+    explicit HistoryJournal(const std::string& path);
+    virtual ~HistoryJournal();
+    
+    bool open();
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+    std::string getPath() const { return path_; }
+    
+    // Non-blocking, called from the UI/model thread
+    void append(RecordType type, const std::string& stream, const std::string& text = "",
+                const std::string& data = "");
+    
+    // Block until every appended record is durable on disk
+    void flush();
+    
+    // Drop all journaled records, called once the document has been saved.
+    // Queued records are discarded at once; the writer thread truncates the
+    // file. False if the journal is not open.
+    bool checkpoint();
+    
+    // Replay the records of one stream on top of the given history, following
+    // renames to the stream's current name. Returns the applied records.
+    static size_t replay(const std::string& path, const std::string& stream, ConstructionHistory& history);
+    
+    // Group commit tuning
+    void setCommitInterval(std::chrono::microseconds interval) { commit_interval_ = interval; }
+    void setCommitBatchBytes(size_t bytes) { commit_batch_bytes_ = bytes; }
+    
+    uint64_t getAppendedCount() const;
+    uint64_t getDurableCount() const;
+    uint64_t getSyncCount() const;
+    
+private:
+    std::string path_;
+    std::atomic<int> fd_;  // Read without the lock by isOpen()
+    
+    std::thread writer_;
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable durable_cv_;
+    
+    std::vector<char> pending_;
+    uint64_t appended_seq_;
+    uint64_t durable_seq_;
+    uint64_t sync_count_;
+    bool checkpoint_requested_;
+    bool flush_requested_;
+    bool stopping_;
+    
+    std::chrono::microseconds commit_interval_;
+    size_t commit_batch_bytes_;
+    
+    void writerLoop();
+    bool writeAll(const char* data, size_t size);
+    
+    static const char MAGIC[4];
+    static const uint32_t VERSION = 2;
+    static const size_t HEADER_SIZE = 8;
+    static const size_t RECORD_HEADER_SIZE = 9;  // size, checksum, type; then stream, text and data
+};
+
+#endif // HISTORY_JOURNAL_H
@@ -0,0 +1,86 @@
+#ifndef HIT_TESTER_H
+#define HIT_TESTER_H
+
+#include "SoftwareRenderer.h"
+#include "RenderThread.h"
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+enum class PickKind {
+    BATCH,
+    POINTS
+};
+
+// Entity under the cursor: a primitive of SceneSnapshot::batches[layer]
+// (triangle, line or point index within the batch) or a live point of
+// SceneSnapshot::point_layers[layer]
+struct PickHit {
+    PickKind kind;
+    uint32_t layer;
+    uint32_t element;
+    
+    bool operator==(const PickHit& other) const {
+        return kind == other.kind && layer == other.layer && element == other.element;
+    }
+    bool operator<(const PickHit& other) const {
+        if (kind != other.kind) return kind < other.kind;
+        if (layer != other.layer) return layer < other.layer;
+        return element < other.element;
+    }
+};
+
+// Hit testing against an ID buffer rendered on the CPU. Every batch
+// primitive and every point gets its own id; the buffer is rendered once
+// and reused by all queries until the scene or the camera changes, so a
+// rectangle query costs one read of the buffer regardless of the number
+// of entities.
+class HitTester {
+public:
+    HitTester(int width = 800, int height = 600);
+    
+    // Copies the snapshot (point layers only share their chunks). The
+    // viewport size stays the tester's own; setCamera() changes it.
+    void setScene(const SceneSnapshot& scene);
+    // Invalidates only if something differs from the current camera
+    void setCamera(const float* projection, const float* model_view, int width, int height);
+    void invalidate() { valid_ = false; }
+    bool isValid() const { return valid_; }
+    
+    // Points are drawn this many pixels wide in the ID pass (default 1);
+    // pick() with a radius is usually the cheaper way to add tolerance
+    void setPointPickSize(float pixels);
+    
+    // Entity at the pixel, or the hit nearest to it within radius pixels
+    std::optional<PickHit> pick(int x, int y, int radius = 0);
+    // Distinct entities visible in the rectangle, corners inclusive, sorted
+    const std::vector<PickHit>& pickRect(int x0, int y0, int x1, int y1);
+    
+    size_t getPassCount() const { return pass_count_; }
+    
+private:
+    struct IdRange {
+        uint32_t first;
+        PickKind kind;
+        uint32_t layer;
+    };
+    
+    SoftwareRenderer renderer_;
+    SceneSnapshot scene_;
+    std::vector<IdRange> ranges_;
+    bool valid_;
+    size_t pass_count_;
+    std::vector<uint32_t> ids_;
+    std::vector<Vertex3D> vertices_;
+    
+    // Last rectangle query, dropped with the ID buffer
+    bool rect_cached_;
+    int cached_rect_[4];
+    std::vector<PickHit> cached_hits_;
+    
+    void renderIdPass();
+    void ensureIdPass();
+    PickHit decode(uint32_t id) const;
+};
+
+#endif // HIT_TESTER_H
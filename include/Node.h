@@ -5,6 +5,9 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <set>
+
+class Value;
 
 class Node {
 public:
@@ -19,6 +22,13 @@ public:
     void* getInput(const std::string& name) const;
     void* getOutput(const std::string& name) const;
     
+    // Ports known to carry a Value, the only ones expressions can read.
+    // The getters return nullptr for ports holding anything else.
+    void addValueInput(const std::string& name, Value* value);
+    void addValueOutput(const std::string& name, Value* value);
+    Value* getValueInput(const std::string& name) const;
+    Value* getValueOutput(const std::string& name) const;
+    
     void connectTo(Node* target_node, const std::string& output_name, const std::string& input_name);
     std::vector<Node*> getConnectedNodes() const;
     
@@ -29,6 +39,8 @@ protected:
     std::string type_;
     std::map<std::string, void*> inputs_;
     std::map<std::string, void*> outputs_;
+    std::set<std::string> value_inputs_;
+    std::set<std::string> value_outputs_;
     std::vector<Node*> connected_nodes_;
 };
 
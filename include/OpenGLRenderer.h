@@ -1,12 +1,35 @@
 #ifndef OPENGL_RENDERER_H
 #define OPENGL_RENDERER_H
 
+#include "VertexLayout.h"
+#include "RenderStats.h"
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
 
-struct Vertex3D {
-    float x, y, z;
-    float r, g, b, a;
-    float nx, ny, nz;
+// Handle of a retained vertex buffer, 0 is never a valid buffer
+using BufferHandle = uint32_t;
+
+enum class PrimitiveType {
+    TRIANGLES,
+    LINES,
+    POINTS
+};
+
+enum class BufferUsage {
+    STATIC,   // Document geometry, rarely edited
+    DYNAMIC,  // Edited often, in ranges
+    STREAM    // Replaced every frame
+};
+
+// Traffic counters, kept in headless mode too
+struct RenderUploadStats {
+    size_t buffer_uploads = 0;    // glBufferData/glBufferSubData calls for retained buffers
+    size_t bytes_uploaded = 0;    // Bytes sent for retained buffers
+    size_t immediate_bytes = 0;   // Bytes sent by drawTriangles/drawLines/drawPoints
+    size_t draw_calls = 0;
+    size_t vertices_drawn = 0;
 };
 
 class OpenGLRenderer {
@@ -14,33 +37,121 @@ public:
     OpenGLRenderer();
     virtual ~OpenGLRenderer();
     
-    bool initialize();
-    void shutdown();
+    virtual bool initialize();
+    virtual void shutdown();
+    
+    virtual void beginRender();
+    virtual void endRender();
+    
+    virtual void setViewport(int width, int height);
+    virtual void clear(float r = 0.0f, float g = 0.0f, float b = 0.0f, float a = 1.0f);
+    
+    virtual void drawTriangles(const std::vector<Vertex3D>& vertices);
+    virtual void drawLines(const std::vector<Vertex3D>& vertices);
+    virtual void drawPoints(const std::vector<Vertex3D>& vertices);
+    
+    // Retained buffers: geometry stays on the GPU between frames and only
+    // ranges edited since the last draw are uploaded again. Vertices are
+    // stored in the smallest VertexLayout that fits them; an update that
+    // needs more (a second color, a normal) converts the buffer once.
+    BufferHandle createBuffer(const std::vector<Vertex3D>& vertices, BufferUsage usage = BufferUsage::STATIC);
+    bool updateBuffer(BufferHandle handle, size_t first_vertex, const Vertex3D* vertices, size_t count);
+    bool updateBuffer(BufferHandle handle, size_t first_vertex, const std::vector<Vertex3D>& vertices) {
+        return updateBuffer(handle, first_vertex, vertices.data(), vertices.size());
+    }
+    bool setBufferData(BufferHandle handle, const std::vector<Vertex3D>& vertices);
+    void destroyBuffer(BufferHandle handle);
+    bool hasBuffer(BufferHandle handle) const { return buffers_.count(handle) != 0; }
+    size_t getBufferVertexCount(BufferHandle handle) const;
+    size_t getBufferCount() const { return buffers_.size(); }
+    VertexLayout getBufferLayout(BufferHandle handle) const;
+    size_t getBufferByteSize(BufferHandle handle) const;
     
-    void beginRender();
-    void endRender();
+    // count 0 draws up to the end of the buffer
+    virtual void drawBuffer(BufferHandle handle, PrimitiveType primitive, size_t first_vertex = 0, size_t count = 0);
     
-    void setViewport(int width, int height);
-    void clear(float r = 0.0f, float g = 0.0f, float b = 0.0f, float a = 1.0f);
+    // ID pass for picking: primitives drawn after setDrawId() carry first_id,
+    // or first_id + their index within the draw call when per_primitive.
+    // A GL backend renders them into an integer target; this one has no
+    // readable ID buffer and readIdBuffer() returns false.
+    virtual void setDrawId(uint32_t /*first_id*/, bool /*per_primitive*/) {}
+    virtual bool readIdBuffer(int /*x*/, int /*y*/, int /*width*/, int /*height*/, std::vector<uint32_t>& /*ids*/) { return false; }
     
-    void drawTriangles(const std::vector<Vertex3D>& vertices);
-    void drawLines(const std::vector<Vertex3D>& vertices);
-    void drawPoints(const std::vector<Vertex3D>& vertices);
+    // Without a GL context: buffers, dirty tracking and stats work, nothing is sent to a GPU
+    void setHeadless(bool headless) { headless_ = headless; }
+    bool isHeadless() const { return headless_; }
     
-    void setProjectionMatrix(const float* matrix);
-    void setModelViewMatrix(const float* matrix);
+    const RenderUploadStats& getUploadStats() const { return upload_stats_; }
+    void resetUploadStats() { upload_stats_ = RenderUploadStats(); }
     
-    void enableDepthTest(bool enable);
-    void enableLighting(bool enable);
+    // Per-frame counters and stage timings; frames are opened and closed by
+    // beginRender()/endRender(), draws outside a frame are not kept
+    RenderStats& getRenderStats() { return render_stats_; }
+    const RenderStats& getRenderStats() const { return render_stats_; }
+    
+    // Column-major 4x4, as glLoadMatrixf takes them
+    virtual void setProjectionMatrix(const float* matrix);
+    virtual void setModelViewMatrix(const float* matrix);
+    const float* getProjectionMatrix() const { return projection_; }
+    const float* getModelViewMatrix() const { return model_view_; }
+    int getViewportWidth() const { return viewport_width_; }
+    int getViewportHeight() const { return viewport_height_; }
+    
+    virtual void enableDepthTest(bool enable);
+    virtual void enableLighting(bool enable);
+    bool isDepthTestEnabled() const { return depth_test_; }
+    bool isLightingEnabled() const { return lighting_; }
     
     bool isInitialized() const { return initialized_; }
     
-private:
+protected:
     bool initialized_;
+    bool headless_;
     int viewport_width_;
     int viewport_height_;
+    float projection_[16];
+    float model_view_[16];
+    bool depth_test_;
+    bool lighting_;
+    RenderStats render_stats_;
+    
+    // Unpacked copy of a retained buffer range for backends without a GPU,
+    // count 0 reads up to the end. False if the handle is unknown.
+    bool readBuffer(BufferHandle handle, size_t first_vertex, size_t count, std::vector<Vertex3D>& vertices) const;
+    void drawArrays(PrimitiveType primitive, size_t count);
+    
+private:
+    struct DirtyRange {
+        size_t begin;
+        size_t end;
+    };
+    
+    struct RetainedBuffer {
+        std::vector<uint8_t> data;       // CPU shadow copy, packed in layout
+        size_t vertex_count = 0;
+        VertexLayout layout = VertexLayout::POSITION;
+        uint32_t uniform_color = 0xFFFFFFFF;  // Color of every vertex in POSITION layout
+        BufferUsage usage;
+        unsigned int gl_buffer = 0;
+        size_t gpu_vertex_count = 0;     // Size of the GPU allocation
+        VertexLayout gpu_layout = VertexLayout::POSITION;
+        std::vector<DirtyRange> dirty;   // Sorted, non-overlapping
+    };
+    
+    std::unordered_map<BufferHandle, RetainedBuffer> buffers_;
+    BufferHandle next_buffer_;
+    RenderUploadStats upload_stats_;
+    std::vector<uint8_t> immediate_data_;  // Packing scratch of the immediate draws
+    
+    static const size_t MAX_DIRTY_RANGES = 8;
     
     void setupOpenGL21();
+    void markDirty(RetainedBuffer& buffer, size_t begin, size_t end);
+    void uploadDirtyRanges(RetainedBuffer& buffer);
+    void drawImmediate(PrimitiveType primitive, const std::vector<Vertex3D>& vertices);
+    void setVertexPointers(VertexLayout layout, uint32_t uniform_color, const uint8_t* base);
+    void convertBuffer(RetainedBuffer& buffer, VertexLayout layout);
+    void storeVertices(RetainedBuffer& buffer, size_t first_vertex, const Vertex3D* vertices, size_t count);
 };
 
 #endif // OPENGL_RENDERER_H
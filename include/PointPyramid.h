@@ -0,0 +1,128 @@
+#ifndef POINT_PYRAMID_H
+#define POINT_PYRAMID_H
+
+#include "OpenGLRenderer.h"
+#include "PointStore.h"
+#include "TaskScheduler.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+struct PyramidStats {
+    size_t nodes_visited = 0;
+    size_t nodes_culled = 0;      // Outside the frustum
+    size_t points_submitted = 0;
+    bool budget_reached = false;  // Finer nodes were left out to stay within the budget
+};
+
+// Multi-resolution quadtree over a point store. Each node keeps at most one
+// point per cell of a GRID_RESOLUTION x GRID_RESOLUTION grid over its square;
+// points landing in an occupied cell go one level down. A node therefore is
+// an evenly spread subsample at its level's spacing, and a frame draws the
+// nodes whose spacing is still visible, coarse to fine, until the vertex
+// budget is used up. Cost per frame depends on the budget, not on the size
+// of the store.
+// Builds run as scheduler tasks and are adopted by a later update();
+// frames keep drawing the previous tree meanwhile. A build works on a
+// copy-on-write copy of the tree: chunks appended to insert their new
+// points, other changed chunks take their old points out and insert their
+// current ones. The tree is rebuilt from scratch when most points changed
+// or new points fall outside the root square.
+class PointPyramid {
+public:
+    static const int GRID_RESOLUTION = 32;
+    static const int MAX_DEPTH = 24;  // Deepest nodes take every point
+    static const size_t DEFAULT_VERTEX_BUDGET = 500000;
+    
+    PointPyramid();
+    virtual ~PointPyramid() = default;
+    
+    PointPyramid(const PointPyramid&) = delete;
+    PointPyramid& operator=(const PointPyramid&) = delete;
+    
+    // Adopts a finished build and starts one if the store changed since the
+    // tree was built. Cheap when nothing changed; call once per frame.
+    void update(const PointStore& points);
+    // Blocks until the running build, if any, is adopted
+    void waitForBuild();
+    bool isBuildPending() const { return pending_ != nullptr; }
+    // True if the adopted tree holds exactly the store's live points
+    bool isCurrent(const PointStore& points) const;
+    // A built tree is drawn even while it lags behind the store
+    bool isBuilt() const { return tree_.root != nullptr; }
+    
+    size_t getPointCount() const { return tree_.point_count; }
+    size_t getNodeCount() const { return tree_.node_count; }
+    
+    void setVertexBudget(size_t vertices) { vertex_budget_ = vertices; }
+    size_t getVertexBudget() const { return vertex_budget_; }
+    // Largest on-screen spacing, in pixels, between points of a drawn level
+    void setMaxScreenError(float pixels) { max_screen_error_ = pixels > 0.0f ? pixels : 0.0f; }
+    float getMaxScreenError() const { return max_screen_error_; }
+    void setPointColor(float r, float g, float b, float a = 1.0f);
+    
+    // Vertices for the renderer's current matrices and viewport, valid until
+    // the next select(); reused while neither the camera nor the tree changed
+    const std::vector<Vertex3D>& select(const OpenGLRenderer& renderer);
+    void draw(OpenGLRenderer& renderer);
+    
+    const PyramidStats& getStats() const { return stats_; }
+    
+private:
+    struct Node {
+        double min_x, min_y, size;
+        int depth;
+        std::vector<float> xy;  // x, y pairs, ready to become vertices
+        std::vector<uint16_t> cells;  // Grid cell of each point, to find it for removal
+        uint64_t occupied[GRID_RESOLUTION * GRID_RESOLUTION / 64] = {};
+        std::shared_ptr<Node> children[4];
+    };
+    
+    // Chunk a build consumed. Sharing it keeps its points as they were, so
+    // the next build can tell appends from edits and take old points out.
+    struct ChunkRecord {
+        std::shared_ptr<const PointChunk> chunk;
+    };
+    
+    struct Tree {
+        std::shared_ptr<Node> root;  // Nodes are shared with builds and copied before writing
+        std::vector<ChunkRecord> chunks;
+        size_t point_count = 0;
+        size_t node_count = 0;
+    };
+    
+    struct PendingBuild {
+        std::atomic<bool> ready{false};
+        Tree tree;
+    };
+    
+    Tree tree_;
+    std::shared_ptr<PendingBuild> pending_;
+    TaskGroup builder_;
+    
+    size_t vertex_budget_;
+    float max_screen_error_;
+    Vertex3D color_;
+    PyramidStats stats_;
+    std::vector<Vertex3D> vertices_;
+    
+    // Inputs of the cached selection
+    const Node* selected_root_;
+    float selected_mvp_[16];
+    int selected_width_;
+    int selected_height_;
+    size_t selected_budget_;
+    float selected_error_;
+    
+    void adopt();
+    static void build(Tree& tree, const PointStore& points);
+    static void rebuild(Tree& tree, const PointStore& points, double min_size);
+    static void insert(Tree& tree, double x, double y);
+    static bool remove(Tree& tree, double x, double y);
+    static Node* writableRoot(Tree& tree);
+    static Node* writableChild(Tree& tree, Node& parent, int quadrant);
+    static bool isPrefix(const PointChunk& prefix, const PointChunk& chunk);
+};
+
+#endif // POINT_PYRAMID_H
@@ -0,0 +1,156 @@
+#ifndef POINT_STORE_H
+#define POINT_STORE_H
+
+#include "2D_point.h"
+#include <vector>
+#include <memory>
+#include <span>
+#include <atomic>
+#include <cstdint>
+
+// Fixed-capacity block of points with cached bounds.
+// Chunks are shared between stores and treated as immutable while shared.
+// Removed points stay in place as tombstones until the store is compacted.
+struct PointChunk {
+    std::vector<Point2D> points;
+    std::vector<uint64_t> dead;  // Tombstone bits, empty while nothing was removed
+    uint32_t live;
+    double min_x, min_y, max_x, max_y;
+    bool has_unassigned_cs;  // Some live point has no coordinate system
+    bool summary_dirty;      // Bounds and flags need a refresh after an edit
+    uint64_t version;        // Process-wide unique, renewed whenever the chunk is opened for writing
+    
+    PointChunk();
+    static uint64_t nextVersion();
+    bool isDead(size_t offset) const {
+        return !dead.empty() && ((dead[offset / 64] >> (offset % 64)) & 1);
+    }
+    void kill(size_t offset);
+    size_t findLive(size_t rank) const;
+    void include(const Point2D& point);
+    void refresh();
+};
+
+// Chunked copy-on-write point storage of Document2D.
+// Copying a store shares all chunks; a chunk is cloned the first time one
+// of its points is modified while another store still references it.
+// Indices count live points only. Single removals just tombstone the point;
+// a Fenwick tree over the per-chunk live counts keeps index lookup
+// logarithmic until the store is compacted.
+class PointStore {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+    static constexpr size_t COMPACTION_RATIO = 4;
+    
+    PointStore();
+    PointStore(const PointStore& other);
+    PointStore& operator=(const PointStore& other);
+    
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    
+    const Point2D& at(size_t index) const {
+        if (tombstones_ == 0) {
+            return chunks_[index / CHUNK_SIZE]->points[index % CHUNK_SIZE];
+        }
+        size_t chunk_index, offset;
+        locate(index, chunk_index, offset);
+        return chunks_[chunk_index]->points[offset];
+    }
+    // Writable point, valid until the store is copied or points are added or removed
+    Point2D* mutableAt(size_t index);
+    // Every live point writable, each chunk detached once
+    std::vector<Point2D*> mutablePoints();
+    
+    void append(const Point2D& point);
+    void append(double x, double y, CS* cs);
+    void removeAt(size_t index);
+    void clear();
+    void reserve(size_t count);
+    
+    // Bulk append straight into the chunks, one bounds update per chunk.
+    // Appends min(xs.size(), ys.size()) points and returns that count.
+    size_t appendCoordinates(std::span<const double> xs, std::span<const double> ys, CS* cs);
+    
+    // Bulk removal: chunks are marked in parallel, then compacted once.
+    // Both return the number of points removed.
+    size_t removeSelection(const std::vector<bool>& selected);
+    size_t removeIndices(std::vector<size_t> indices);
+    
+    // Rebuild full chunks without tombstones. Leading chunks without
+    // tombstones stay shared, the rest is rebuilt in parallel.
+    void compact();
+    
+    // Adopt a finished background compaction, or start one on the task
+    // scheduler once more than 1/COMPACTION_RATIO of the stored points are
+    // tombstones. Removals and appends made while the job ran are replayed
+    // onto its result, and chunks edited since are copied over.
+    void compactIfNeeded();
+    bool isCompactionPending() const { return pending_ != nullptr; }
+    size_t getTombstoneCount() const { return tombstones_; }
+    
+    // Give points without a coordinate system this one, touching only the
+    // chunks that contain such points
+    void assignMissingCoordinateSystem(CS* cs);
+    
+    // Cached and extended on append, false if empty
+    bool getBounds(double& min_x, double& min_y, double& max_x, double& max_y) const;
+    
+    // Raw chunks, may contain tombstones (see PointChunk::isDead)
+    size_t getChunkCount() const { return chunks_.size(); }
+    const PointChunk& getChunk(size_t index) const { return *chunks_[index]; }
+    // The chunk itself: its points stay as they are while it is shared,
+    // the store writes to a clone instead
+    std::shared_ptr<const PointChunk> shareChunk(size_t index) const { return chunks_[index]; }
+    size_t getSharedChunkCount() const;
+    
+private:
+    using ChunkList = std::vector<std::shared_ptr<PointChunk>>;
+    
+    // Structural edit made while a compaction runs: a removal by live
+    // index or a number of appended points
+    struct ReplayedEdit {
+        bool append;
+        size_t value;
+    };
+    
+    struct PendingCompaction {
+        std::atomic<bool> ready{false};
+        ChunkList source;  // Snapshot the job compacts, shared with the store
+        size_t live = 0;
+        ChunkList chunks;  // Written by the job only
+        std::vector<ReplayedEdit> edits;  // Written by the store only
+    };
+    
+    ChunkList chunks_;
+    size_t size_;
+    size_t tombstones_;
+    uint64_t revision_;  // Bumped by every edit
+    std::shared_ptr<PendingCompaction> pending_;
+    
+    // Fenwick tree of live counts per chunk (1-based), kept while tombstones exist
+    std::vector<size_t> live_tree_;
+    bool tree_valid_;
+    
+    // Store-wide bounds, recomputed from the chunks after edits that can shrink them
+    mutable double min_x_, min_y_, max_x_, max_y_;
+    mutable bool bounds_valid_;
+    
+    PointChunk& mutableChunk(size_t chunk_index);
+    PointChunk& appendChunk();
+    void refreshDirtyChunks() const;
+    void resetBounds() const;
+    
+    void locate(size_t index, size_t& chunk_index, size_t& offset) const;
+    void buildTree();
+    void treeAdd(size_t chunk_index, long delta);
+    size_t treePrefix(size_t chunk_count) const;
+    void adoptCompacted(ChunkList chunks);
+    void rebaseCompacted(PendingCompaction& job);
+    void recordEdit(bool append, size_t value);
+    size_t compactMarked(size_t removed);
+    
+    static ChunkList buildCompacted(const ChunkList& chunks, size_t live_count);
+};
+
+#endif // POINT_STORE_H
@@ -0,0 +1,77 @@
+#ifndef RENDER_COMMAND_BUFFER_H
+#define RENDER_COMMAND_BUFFER_H
+
+#include "OpenGLRenderer.h"
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+struct RenderCommandStats {
+    size_t commands = 0;       // Recorded draws
+    size_t draw_calls = 0;     // Draws sent to the renderer
+    size_t state_changes = 0;  // Depth test, lighting and material switches actually applied
+};
+
+// Records draw calls with the state they were issued under and submits
+// them in one go: commands are sorted by state key (depth test, lighting,
+// material, primitive) and consecutive immediate draws with the same key
+// are merged into one draw of up to MAX_MERGED_VERTICES vertices. Immediate
+// draws keep whole primitives only, trailing vertices are dropped.
+// Commands without depth test are drawn last and keep their recording
+// order, since their result depends on it.
+// All commands of a buffer are drawn with the renderer's matrices at
+// submit time.
+class RenderCommandBuffer {
+public:
+    static const size_t MAX_MERGED_VERTICES = 65536;
+    
+    RenderCommandBuffer();
+    
+    void setDepthTest(bool enable) { depth_test_ = enable; }
+    void setLighting(bool enable) { lighting_ = enable; }
+    // Opaque id, handed to the material callback when it changes during submit
+    void setMaterial(uint32_t material) { material_ = material; }
+    void setMaterialCallback(std::function<void(uint32_t)> callback) { material_callback_ = std::move(callback); }
+    
+    void drawTriangles(const std::vector<Vertex3D>& vertices) { draw(PrimitiveType::TRIANGLES, vertices.data(), vertices.size()); }
+    void drawLines(const std::vector<Vertex3D>& vertices) { draw(PrimitiveType::LINES, vertices.data(), vertices.size()); }
+    void drawPoints(const std::vector<Vertex3D>& vertices) { draw(PrimitiveType::POINTS, vertices.data(), vertices.size()); }
+    void draw(PrimitiveType primitive, const Vertex3D* vertices, size_t count);
+    // Retained buffers are sorted with the rest but never merged
+    void drawBuffer(BufferHandle handle, PrimitiveType primitive, size_t first_vertex = 0, size_t count = 0);
+    
+    // Sort, merge, draw and clear. Renderer state is only touched when it
+    // differs from what the renderer already has.
+    void submit(OpenGLRenderer& renderer);
+    void clear();
+    
+    size_t getCommandCount() const { return commands_.size(); }
+    size_t getVertexCount() const { return vertices_.size(); }
+    const RenderCommandStats& getStats() const { return stats_; }
+    
+private:
+    struct Command {
+        uint64_t state;     // Depth test, lighting, material, primitive, retained
+        uint64_t sort_key;  // state for depth-tested draws, recording order otherwise
+        uint32_t sequence;
+        PrimitiveType primitive;
+        BufferHandle buffer;  // 0 for immediate vertices
+        size_t first;         // Into vertices_, or into the retained buffer
+        size_t count;
+    };
+    
+    bool depth_test_;
+    bool lighting_;
+    uint32_t material_;
+    std::function<void(uint32_t)> material_callback_;
+    std::vector<Command> commands_;
+    std::vector<Vertex3D> vertices_;
+    std::vector<Vertex3D> merged_;
+    RenderCommandStats stats_;
+    
+    void record(PrimitiveType primitive, BufferHandle buffer, size_t first, size_t count);
+    void applyState(OpenGLRenderer& renderer, const Command& command, bool& material_known, uint32_t& material);
+    void drawMerged(OpenGLRenderer& renderer, PrimitiveType primitive);
+};
+
+#endif // RENDER_COMMAND_BUFFER_H
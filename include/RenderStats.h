@@ -0,0 +1,103 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+enum class RenderStage {
+    CULL,      // CullingStage selection and vertex output
+    SORT,      // RenderCommandBuffer sorting and batch merging
+    GEOMETRY,  // Vertex packing, transform and binning inside draw calls
+    RASTER,    // Software tile rasterization
+    COUNT
+};
+
+struct RenderFrameStats {
+    size_t draw_calls = 0;
+    size_t primitives = 0;
+    size_t vertices = 0;
+    size_t bytes_uploaded = 0;     // Retained buffer uploads plus immediate vertex data
+    size_t chunks_tested = 0;
+    size_t chunks_culled = 0;
+    size_t points_visible = 0;
+    size_t points_submitted = 0;
+    double stage_milliseconds[static_cast<int>(RenderStage::COUNT)] = {};
+    double frame_milliseconds = 0.0;
+};
+
+// Per-frame render counters and timings. Renderers open and close frames
+// in beginRender()/endRender(); stages add their time and counters while
+// a frame is open. Safe to read from another thread while a render
+// thread records.
+class RenderStats {
+public:
+    // Upper bounds of the frame time histogram buckets, in milliseconds;
+    // the last bucket takes everything slower
+    static const int HISTOGRAM_BUCKETS = 10;
+    static const double BUCKET_LIMITS[HISTOGRAM_BUCKETS - 1];
+    // Frames kept for percentiles
+    static const size_t FRAME_WINDOW = 240;
+    
+    RenderStats();
+    
+    void beginFrame();
+    void endFrame();
+    bool isInFrame() const;
+    
+    void addStageTime(RenderStage stage, double milliseconds);
+    void addDraw(size_t primitives, size_t vertices);
+    void addUploadedBytes(size_t bytes);
+    void addCulling(size_t chunks_tested, size_t chunks_culled, size_t points_visible, size_t points_submitted);
+    
+    uint64_t getFrameCount() const;
+    RenderFrameStats getLastFrame() const;
+    std::vector<uint64_t> getHistogram() const;
+    // Frame time percentile over the last FRAME_WINDOW frames, 0 without frames
+    double getFramePercentile(double percentile) const;
+    double getAverageFrameMilliseconds() const;
+    
+    void reset();
+    // Multi-line summary, used by the renderstats terminal command
+    std::string format() const;
+    
+    static const char* getStageName(RenderStage stage);
+    
+private:
+    mutable std::mutex mutex_;
+    bool in_frame_;
+    std::chrono::steady_clock::time_point frame_start_;
+    RenderFrameStats current_;
+    RenderFrameStats last_;
+    uint64_t frame_count_;
+    double total_frame_milliseconds_;
+    uint64_t histogram_[HISTOGRAM_BUCKETS];
+    std::vector<double> recent_;  // Ring of the last FRAME_WINDOW frame times
+    size_t recent_next_;
+    
+    double percentileLocked(double percentile) const;
+};
+
+// Adds the time between construction and destruction to a stage
+class RenderStageTimer {
+public:
+    RenderStageTimer(RenderStats& stats, RenderStage stage)
+        : stats_(stats), stage_(stage), start_(std::chrono::steady_clock::now()) {
+    }
+    ~RenderStageTimer() {
+        stats_.addStageTime(stage_, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count());
+    }
+    
+    RenderStageTimer(const RenderStageTimer&) = delete;
+    RenderStageTimer& operator=(const RenderStageTimer&) = delete;
+    
+private:
+    RenderStats& stats_;
+    RenderStage stage_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // RENDER_STATS_H
@@ -0,0 +1,146 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include "OpenGLRenderer.h"
+#include "PointStore.h"
+#include "CullingStage.h"
+#include "PointPyramid.h"
+#include "RenderCommandBuffer.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+
+struct SceneBatch {
+    PrimitiveType primitive;
+    bool depth_test;
+    bool lighting;
+    uint32_t material;
+    std::vector<Vertex3D> vertices;
+};
+
+struct ScenePointLayer {
+    PointStore points;  // Shares the document's chunks, edits after publishing clone them
+    float r, g, b, a;
+};
+
+// Everything the render thread needs for one frame. Filled by the model
+// thread, read-only once published.
+struct SceneSnapshot {
+    uint64_t frame;  // Set by publish()
+    int viewport_width;
+    int viewport_height;
+    float projection[16];
+    float model_view[16];
+    float clear_color[4];
+    std::vector<SceneBatch> batches;
+    std::vector<ScenePointLayer> point_layers;
+    
+    SceneSnapshot();
+    // Back to an empty scene with identity matrices
+    void reset();
+    void setProjectionMatrix(const float* matrix);
+    void setModelViewMatrix(const float* matrix);
+    void addBatch(PrimitiveType primitive, const std::vector<Vertex3D>& vertices,
+                  bool depth_test = true, bool lighting = false, uint32_t material = 0);
+    void addPoints(const PointStore& points, float r = 1.0f, float g = 1.0f, float b = 1.0f, float a = 1.0f);
+};
+
+struct RenderThreadStats {
+    uint64_t snapshots_published = 0;
+    uint64_t snapshots_dropped = 0;  // Replaced before the render thread picked them up
+    uint64_t frames_rendered = 0;
+    double last_frame_milliseconds = 0.0;
+};
+
+// Renders published scene snapshots on a dedicated thread.
+// Snapshots live in a triple buffer: the model thread fills the back slot
+// and publishes it with one atomic exchange, the render thread swaps the
+// newest published slot into its front slot. Neither side ever waits for
+// the other; a snapshot published while the previous one is still unrendered
+// replaces it. Frames are paced to the target frame rate, 0 renders as soon
+// as a snapshot arrives.
+// Point layers of at least PYRAMID_MIN_POINTS points are drawn from a
+// PointPyramid once its first build is done, also while later builds catch
+// up with edits, so their cost stays within the pyramid's vertex budget.
+// Smaller layers, and large ones until the first build, go through a
+// CullingStage.
+// Parallel work of a frame runs on the shared scheduler; a frame waiting on
+// it only runs its own chunks.
+// While the thread runs, the renderer must not be used from other threads.
+class RenderThread {
+public:
+    static const size_t PYRAMID_MIN_POINTS = 1 << 18;
+    
+    explicit RenderThread(OpenGLRenderer& renderer);
+    virtual ~RenderThread();
+    
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+    
+    // Model thread: fill the snapshot returned by beginSnapshot(), then publish()
+    SceneSnapshot& beginSnapshot();
+    uint64_t publish();
+    
+    void start();
+    void stop();
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+    
+    void setTargetFrameRate(double frames_per_second);
+    double getTargetFrameRate() const { return target_fps_.load(std::memory_order_relaxed); }
+    
+    // Render the newest snapshot on the calling thread if there is one,
+    // for use without start()
+    bool renderPending();
+    
+    // Blocks until the frame returned by publish() (or a later one) was rendered
+    bool waitForFrame(uint64_t frame, std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+    uint64_t getRenderedFrame() const { return rendered_frame_.load(std::memory_order_acquire); }
+    
+    // Called on the render thread after each frame, e.g. to present it.
+    // Only before start().
+    void setOnFrameRendered(std::function<void(const SceneSnapshot&)> callback);
+    
+    RenderThreadStats getStats() const;
+    
+private:
+    // Ready slot word: slot index plus FRESH while not yet picked up
+    static const uint32_t FRESH = 4;
+    static const uint32_t SLOT_MASK = 3;
+    
+    OpenGLRenderer& renderer_;
+    SceneSnapshot slots_[3];
+    uint32_t back_;                  // Model thread only
+    uint32_t front_;                 // Render thread only
+    std::atomic<uint32_t> ready_;
+    uint64_t next_frame_;            // Model thread only
+    
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    std::atomic<double> target_fps_;
+    std::mutex render_mutex_;        // Serializes renderPending() with the thread
+    
+    std::atomic<uint64_t> rendered_frame_;
+    std::mutex frame_mutex_;
+    std::condition_variable frame_cv_;
+    
+    mutable std::mutex stats_mutex_;
+    RenderThreadStats stats_;
+    
+    std::vector<std::unique_ptr<CullingStage>> culling_;
+    std::vector<std::unique_ptr<PointPyramid>> pyramids_;
+    RenderCommandBuffer commands_;
+    std::function<void(const SceneSnapshot&)> on_frame_rendered_;
+    
+    void threadLoop();
+    bool acquireFront();
+    void renderFront();
+};
+
+#endif // RENDER_THREAD_H
@@ -0,0 +1,95 @@
+#ifndef SHARED_MEMORY_EXCHANGE_H
+#define SHARED_MEMORY_EXCHANGE_H
+
+#include "DataExchange.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+class Solution;
+
+// Descriptor written in front of every batch in the shared ring (64 bytes)
+struct ShmBatchDescriptor {
+    uint32_t kind;
+    uint32_t element_size;
+    uint64_t element_count;
+    uint64_t payload_bytes;
+    uint64_t sequence;
+    char data_type[32];
+};
+
+// Read-only view of a batch that still lives in shared memory
+struct ShmBatchView {
+    const ShmBatchDescriptor* descriptor = nullptr;
+    const void* data = nullptr;
+};
+
+// DataExchange transport between processes on the same machine, backed by
+// a POSIX shared-memory single-producer/single-consumer ring. The producer
+// writes point/mesh batches straight into the mapping and the consumer
+// reads them in place, nothing is copied through the kernel.
+class SharedMemoryExchange : public DataExchange {
+public:
+    enum class Role {
+        PRODUCER,
+        CONSUMER
+    };
+    
+    enum class BatchKind : uint32_t {
+        POINTS_2D = 1,
+        POINTS_3D = 2,
+        MESH = 3
+    };
+    
+    SharedMemoryExchange(const std::string& name, Role role, size_t capacity = 16 * 1024 * 1024);
+    virtual ~SharedMemoryExchange();
+    
+    // Producer creates the segment, consumer attaches to an existing one
+    bool open();
+    void close();
+    bool isOpen() const { return header_ != nullptr; }
+    Role getRole() const { return role_; }
+    std::string getName() const { return name_; }
+    
+    // Producer side
+    bool sendBatch(BatchKind kind, const std::string& data_type, const void* data,
+                   size_t element_size, size_t element_count);
+    void* beginBatch(BatchKind kind, const std::string& data_type, size_t element_size, size_t element_count);
+    void commitBatch();
+    
+    // Consumer side, the view stays valid until releaseBatch()
+    bool peekBatch(ShmBatchView& view);
+    void releaseBatch();
+    
+    // Drain pending batches into a local solution as DataBuffers of doubles
+    size_t pump(Solution* target, size_t max_batches = 64);
+    
+    // DataExchange interface: buffers of std::vector<double> are forwarded to the peer process
+    virtual bool canProcess(const std::string& data_type) const override;
+    virtual void* processData(void* data, const std::string& data_type) override;
+    virtual std::vector<std::string> getSupportedDataTypes() const override;
+    virtual DataBuffer processBuffer(const DataBuffer& buffer) override;
+    
+    static BatchKind kindForDataType(const std::string& data_type);
+    
+private:
+    struct RingHeader;
+    
+    std::string name_;
+    Role role_;
+    size_t capacity_;
+    int fd_;
+    void* mapping_;
+    size_t mapping_size_;
+    RingHeader* header_;
+    char* ring_;
+    uint64_t pending_tail_;  // Producer position after the batch being built
+    uint64_t peeked_head_;   // Consumer position after the batch being read
+    uint64_t sequence_;
+    
+    static const uint32_t PADDING_KIND = 0xFFFFFFFFu;
+    static const size_t RECORD_ALIGNMENT = 64;
+};
+
+#endif // SHARED_MEMORY_EXCHANGE_H
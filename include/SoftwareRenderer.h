@@ -0,0 +1,117 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include "OpenGLRenderer.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// CPU backend of the OpenGLRenderer interface for machines without a GPU.
+// Draw calls transform their vertices right away and bin the resulting
+// screen-space primitives into TILE_SIZE tiles; endRender() (or reading the
+// framebuffer) rasterizes all tiles in parallel on the task scheduler.
+// Each tile is owned by one task, so no two threads touch the same pixel.
+class SoftwareRenderer : public OpenGLRenderer {
+public:
+    static const int TILE_SIZE = 64;
+    
+    SoftwareRenderer(int width = 800, int height = 600);
+    ~SoftwareRenderer() override;
+    
+    bool initialize() override;
+    void shutdown() override;
+    
+    void beginRender() override;
+    void endRender() override;
+    
+    void setViewport(int width, int height) override;
+    // Pending primitives are dropped, the clear overwrites them anyway
+    void clear(float r = 0.0f, float g = 0.0f, float b = 0.0f, float a = 1.0f) override;
+    
+    void drawTriangles(const std::vector<Vertex3D>& vertices) override;
+    void drawLines(const std::vector<Vertex3D>& vertices) override;
+    void drawPoints(const std::vector<Vertex3D>& vertices) override;
+    void drawBuffer(BufferHandle handle, PrimitiveType primitive, size_t first_vertex = 0, size_t count = 0) override;
+    
+    // Side of the square drawn for each point, in pixels
+    void setPointSize(float size) { point_size_ = size < 1.0f ? 1.0f : size; }
+    float getPointSize() const { return point_size_; }
+    
+    // Rasterize everything binned so far
+    void flush();
+    size_t getPendingPrimitiveCount() const { return triangles_.size() + pending_points_; }
+    
+    // Framebuffer access flushes first. Rows run top to bottom, pixels are
+    // RGBA8 as packColor() stores them.
+    const std::vector<uint32_t>& getColorBuffer();
+    uint32_t getPixel(int x, int y);
+    float getDepth(int x, int y);
+    
+    // ID pass: while enabled, every drawn pixel also stores the id of its
+    // primitive (see setDrawId); 0 means nothing was drawn there
+    void enableIdBuffer(bool enable);
+    bool isIdBufferEnabled() const { return id_enabled_; }
+    void setDrawId(uint32_t first_id, bool per_primitive) override;
+    bool readIdBuffer(int x, int y, int width, int height, std::vector<uint32_t>& ids) override;
+    
+    bool writePPM(const std::string& path);
+    bool writePNG(const std::string& path);
+    
+private:
+    struct ClipVertex {
+        float x, y, z, w;
+        float r, g, b, a;
+    };
+    
+    struct ScreenVertex {
+        float x, y, z;
+        float r, g, b, a;
+    };
+    
+    struct Triangle {
+        ScreenVertex v[3];
+        uint32_t id;
+        bool depth_test;
+    };
+    
+    // Points are stored in the bins themselves, one entry per covered pixel,
+    // so rasterizing them never leaves the tile's own memory
+    struct BinEntry {
+        uint32_t primitive;  // Triangle index, or PIXEL_ENTRY | framebuffer offset
+        float z;
+        uint32_t color;
+        uint32_t id;
+    };
+    
+    static const uint32_t PIXEL_ENTRY = 0x80000000u;
+    static const uint32_t DEPTH_TESTED = 0x40000000u;
+    static const uint32_t OFFSET_MASK = 0x3FFFFFFFu;
+    
+    std::vector<uint32_t> color_;
+    std::vector<float> depth_;
+    std::vector<uint32_t> ids_;  // Empty unless the ID pass is enabled
+    bool id_enabled_;
+    uint32_t draw_id_;
+    bool per_primitive_id_;
+    int tiles_x_;
+    int tiles_y_;
+    std::vector<std::vector<BinEntry>> bins_;
+    std::vector<Triangle> triangles_;
+    size_t pending_points_;
+    std::vector<ClipVertex> clip_;
+    std::vector<Vertex3D> buffer_vertices_;
+    float point_size_;
+    
+    void resizeFramebuffer();
+    void submit(PrimitiveType primitive, const std::vector<Vertex3D>& vertices);
+    void transformVertices(const std::vector<Vertex3D>& vertices);
+    ScreenVertex toScreen(const ClipVertex& vertex) const;
+    void addTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, uint32_t id);
+    void addLine(const ClipVertex& a, const ClipVertex& b, uint32_t id);
+    void addPoint(const ClipVertex& vertex, uint32_t id);
+    void binScreenTriangle(const Triangle& triangle);
+    void rasterizeTile(size_t tile);
+    void rasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+};
+
+#endif // SOFTWARE_RENDERER_H
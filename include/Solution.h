@@ -5,11 +5,18 @@
 #include "Node.h"
 #include "XTD.h"
 #include "DataExchange.h"
+#include "SolutionInbox.h"
+#include "TaskScheduler.h"
 #include "OpenGLRenderer.h"
 #include "TerminalWindow.h"
 #include <vector>
 #include <memory>
 #include <string>
+#include <atomic>
+
+// Defined in RenderThread.h, which depends on CS.h through the point store
+class RenderThread;
+class SolutionDocument;
 
 class Solution : public DataExchangeInterface {
 public:
@@ -55,7 +62,20 @@ public:
     // OpenGL rendering
     OpenGLRenderer* getRenderer() { return renderer_.get(); }
     void initializeRenderer();
+    // Replace the default backend, e.g. with a SoftwareRenderer on machines without a GPU
+    void setRenderer(std::unique_ptr<OpenGLRenderer> renderer);
     void render();
+    // Size render() draws at. Kept here rather than read back from the
+    // renderer, which belongs to the render thread while it runs.
+    void setViewport(int width, int height);
+    int getViewportWidth() const { return viewport_width_; }
+    int getViewportHeight() const { return viewport_height_; }
+    
+    // Dedicated render thread: render() then publishes a scene snapshot
+    // instead of drawing on the calling thread
+    RenderThread* startRenderThread(double frames_per_second = 60.0);
+    void stopRenderThread();
+    RenderThread* getRenderThread() const { return render_thread_.get(); }
     
     // Data exchange interface implementation
     virtual bool canReceiveData(const std::string& data_type) const override;
@@ -63,27 +83,72 @@ public:
     virtual void* receiveData(void* data, const std::string& data_type) override;
     virtual void* sendData(const std::string& data_type) override;
     
-    // Solution identification
-    void setName(const std::string& name) { name_ = name; }
+    // Solution identification. Renaming a solution that belongs to a
+    // document invalidates that document's name index.
+    void setName(const std::string& name);
     std::string getName() const { return name_; }
     
     // Data exchange with other solutions
     bool canExchangeDataWith(Solution* other_solution, const std::string& data_type);
     void* exchangeDataWith(Solution* other_solution, const std::string& data_type, void* data);
     
+    // Typed data exchange, capabilities are declared once per registered type id
+    void declareDataType(DataTypeId type, bool can_send, bool can_receive);
+    bool canSendBuffer(DataTypeId type) const {
+        return type < buffer_capabilities_.size() && (buffer_capabilities_[type] & CAN_SEND);
+    }
+    bool canReceiveBuffer(DataTypeId type) const {
+        return (type < buffer_capabilities_.size() && (buffer_capabilities_[type] & CAN_RECEIVE)) ||
+               findDataExchange(type) != nullptr;
+    }
+    DataBuffer sendBuffer(DataTypeId type);
+    DataBuffer receiveBuffer(const DataBuffer& buffer);
+    DataBuffer exchangeBufferWith(Solution* other_solution, DataTypeId type);
+    
+    // Asynchronous data exchange through the receiver's inbox. Incoming
+    // buffers are processed on the inbox worker thread once it is started.
+    // The worker calls processIncomingBuffer(), so whoever destroys the
+    // solution must call stopInbox() first (SolutionDocument does). The base
+    // destructor asserts that the worker is stopped and drops what is queued.
+    SolutionInbox* enableInbox(size_t capacity = 256);
+    SolutionInbox* getInbox() const { return inbox_.get(); }
+    void startInbox();
+    void stopInbox();
+    std::future<DataBuffer> postBuffer(const DataBuffer& buffer);
+    std::future<DataBuffer> exchangeBufferAsync(Solution* other_solution, DataTypeId type);
+    
+    // Process-wide task scheduler shared by all solutions, nodes and kernels
+    static TaskScheduler& getScheduler() { return TaskScheduler::instance(); }
+    
 protected:
     // Override these methods to define data processing capabilities
     virtual bool canProcessDataType(const std::string& data_type) const;
     virtual void* processIncomingData(void* data, const std::string& data_type);
     virtual void* prepareOutgoingData(const std::string& data_type);
     
+    // Typed counterparts, override to produce and consume shared buffers
+    virtual DataBuffer prepareOutgoingBuffer(DataTypeId type);
+    virtual DataBuffer processIncomingBuffer(const DataBuffer& buffer);
+    
 private:
     std::string name_;
     ConstructionHistory construction_history_;
     std::vector<std::unique_ptr<Node>> nodes_;
     std::unique_ptr<XTD> xtd_;
     std::unique_ptr<OpenGLRenderer> renderer_;
+    std::unique_ptr<RenderThread> render_thread_;  // Declared after renderer_, stops before it is destroyed
     std::unique_ptr<TerminalWindow> terminal_;
+    std::vector<uint8_t> buffer_capabilities_;
+    std::unique_ptr<SolutionInbox> inbox_;
+    
+    int viewport_width_;
+    int viewport_height_;
+    const SolutionDocument* document_;  // Document holding this solution, set by SolutionDocument
+    
+    friend class SolutionDocument;
+    
+    static const uint8_t CAN_SEND = 1;
+    static const uint8_t CAN_RECEIVE = 2;
     
     std::string processTerminalCommand(const std::string& command);
 };
@@ -2,14 +2,48 @@
 #define SOLUTION_DOCUMENT_H
 
 #include "Solution.h"
+#include "HistoryJournal.h"
 #include <string>
 #include <memory>
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Stable reference to a solution of a document. Stays valid while the
+// solution exists and never aliases a solution added later into the same slot.
+struct SolutionHandle {
+    static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+    
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+    
+    bool isValid() const { return index != INVALID_INDEX; }
+    bool operator==(const SolutionHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const SolutionHandle& other) const { return !(*this == other); }
+};
+
+// Result of SolutionDocument::solveAll(), entries are in document order
+struct SolveReport {
+    struct Entry {
+        Solution* solution = nullptr;
+        std::string name;
+        size_t level = 0;       // Dependency level, solutions of one level run concurrently
+        bool in_cycle = false;  // Part of or behind a dependency cycle, solved serially
+        double milliseconds = 0.0;
+    };
+    
+    std::vector<Entry> entries;
+    size_t level_count = 0;
+    size_t cyclic_count = 0;
+    double total_milliseconds = 0.0;
+};
 
 class SolutionDocument {
 public:
     SolutionDocument();
-    virtual ~SolutionDocument() = default;
+    virtual ~SolutionDocument();
     
     // Document identification
     void setName(const std::string& name) { name_ = name; }
@@ -43,17 +77,39 @@ public:
     virtual std::vector<std::string> getSupportedImportFormats() const = 0;
     virtual std::vector<std::string> getSupportedExportFormats() const = 0;
     
-    // Solution management
-    void addSolution(std::unique_ptr<Solution> solution);
+    // Solution management. Removal moves the last solution into the freed
+    // position, so indices are not stable; hold a SolutionHandle instead.
+    SolutionHandle addSolution(std::unique_ptr<Solution> solution);
     Solution* getSolution(size_t index) const;
     Solution* getSolution(const std::string& name) const;
+    Solution* getSolution(SolutionHandle handle) const;
     size_t getSolutionCount() const { return solutions_.size(); }
     void removeSolution(size_t index);
     void removeSolution(const std::string& name);
+    bool removeSolution(SolutionHandle handle);
     void clearSolutions();
     
+    SolutionHandle getHandle(size_t index) const;
+    SolutionHandle findSolution(const std::string& name) const;
+    bool isValid(SolutionHandle handle) const;
+    
     std::vector<Solution*> getAllSolutions() const;
     
+    // Solve every solution. Data exchanges registered on the solutions define
+    // the dependencies (source before target); independent solutions are
+    // solved concurrently on the calling thread's scheduler
+    // (TaskScheduler::current()).
+    SolveReport solveAll();
+    
+    // Crash recovery journal, checkpointed whenever the document is saved.
+    // Every solution journals its history under its own name. Once the
+    // document is open (right away, or on the next load) each solution's
+    // records are replayed onto its history; solutions added later replay
+    // theirs when they are added.
+    bool enableJournal(const std::string& journal_path);
+    void disableJournal();
+    HistoryJournal* getJournal() const { return journal_.get(); }
+    
     // Document metadata
     void setAuthor(const std::string& author) { author_ = author; }
     std::string getAuthor() const { return author_; }
@@ -72,6 +128,39 @@ protected:
     std::string description_;
     std::string version_;
     std::vector<std::unique_ptr<Solution>> solutions_;
+    std::shared_ptr<HistoryJournal> journal_;  // Shared with the histories recovered from it
+    bool journal_recovered_;
+    
+    // Replays the journal onto the solutions, called by load() once the
+    // saved content is in place
+    void recoverJournal();
+    void attachJournal(Solution& solution);
+    
+private:
+    struct HandleSlot {
+        uint32_t position;    // Index into solutions_ while alive
+        uint32_t generation;  // Bumped on removal to invalidate old handles
+    };
+    
+    // Handle slots, mutable so const lookups can pick up solutions
+    // that derived classes pushed into solutions_ directly
+    mutable std::vector<HandleSlot> slots_;
+    mutable std::vector<uint32_t> free_slots_;
+    mutable std::vector<uint32_t> position_slots_;  // solutions_ position -> slot
+    
+    // Name -> first solution found with that name, plus how many share it
+    struct NameEntry {
+        SolutionHandle handle;
+        uint32_t count;
+    };
+    mutable std::unordered_map<std::string, NameEntry> name_index_;
+    mutable bool name_index_valid_;  // Cleared when a solution of this document is renamed
+    
+    void syncHandles() const;
+    void solutionRenamed() const { name_index_valid_ = false; }
+    friend class Solution;
+    void removeAt(size_t position);
+    void refreshNameIndex() const;
 };
 
 #endif // SOLUTION_DOCUMENT_H
@@ -0,0 +1,72 @@
+#ifndef SOLUTION_INBOX_H
+#define SOLUTION_INBOX_H
+
+#include "DataBuffer.h"
+#include "SpscRing.h"
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <limits>
+
+class Solution;
+
+struct InboxMessage {
+    DataBuffer buffer;
+    std::promise<DataBuffer> reply;
+};
+
+// Bounded inbox of a Solution for asynchronous data exchange.
+// Backed by a lock-free SPSC ring: producers are serialized by a mutex so
+// any number of solutions may post, and exactly one consumer (the inbox
+// worker or a caller of process()) drains it at a time.
+// While the worker runs, post() blocks while the ring is full, which applies
+// backpressure upstream. Without a worker post() processes the buffer on the
+// calling thread, after anything queued before it. A post from one of the
+// owner's own handlers never waits: it is queued behind the running drain, or
+// processed at once if the ring is full.
+class SolutionInbox {
+public:
+    explicit SolutionInbox(Solution* owner, size_t capacity = 256);
+    virtual ~SolutionInbox();
+    
+    std::future<DataBuffer> post(const DataBuffer& buffer);
+    // Queues without blocking, even without a worker (drain with process())
+    bool tryPost(const DataBuffer& buffer, std::future<DataBuffer>& result);
+    
+    // Drain messages on the calling thread, returns processed count
+    size_t process(size_t max_messages = std::numeric_limits<size_t>::max());
+    
+    // Dedicated consumer thread. stop() completes the queued messages unless
+    // process_pending is false; dropped messages' futures report broken_promise.
+    void start();
+    void stop(bool process_pending = true);
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+    
+    size_t getPendingCount() const { return ring_.size(); }
+    size_t getCapacity() const { return ring_.capacity(); }
+    
+private:
+    Solution* owner_;
+    SpscRing<InboxMessage> ring_;
+    std::thread worker_;
+    std::mutex post_mutex_;     // Producer side of the ring, also orders start/stop against post
+    std::mutex consume_mutex_;  // Consumer side of the ring
+    std::atomic<bool> running_;
+    std::atomic<bool> worker_sleeping_;
+    std::atomic<int> producers_waiting_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;   // Worker waits for messages
+    std::condition_variable space_cv_;  // Producers wait for room
+    
+    void workerLoop();
+    size_t drain(size_t max_messages);
+    void deliver(InboxMessage& message);
+    void wakeWorker();
+    void wakeProducers();
+    
+    static const int IDLE_SPINS = 64;
+};
+
+#endif // SOLUTION_INBOX_H
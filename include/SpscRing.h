@@ -0,0 +1,80 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free single-producer/single-consumer ring buffer.
+// Exactly one thread may push and exactly one thread may pop at a time.
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : slots_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)), mask_(slots_.size() - 1),
+          head_(0), tail_(0), cached_head_(0), cached_tail_(0) {
+    }
+    
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    
+    // Producer side
+    bool tryPush(T&& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == slots_.size()) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == slots_.size()) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer side
+    bool tryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        value = std::move(slots_[head & mask_]);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    
+    size_t capacity() const { return slots_.size(); }
+    
+    // Approximate when called concurrently with push/pop
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    
+private:
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+    
+    static const size_t CACHE_LINE_SIZE = 64;
+    
+    std::vector<T> slots_;
+    const size_t mask_;
+    
+    // Producer and consumer indices live on separate cache lines
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+    alignas(CACHE_LINE_SIZE) size_t cached_head_;  // Producer's view of head_
+    alignas(CACHE_LINE_SIZE) size_t cached_tail_;  // Consumer's view of tail_
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,104 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+// Process-wide work-stealing scheduler of the microkernel.
+// Every worker owns a deque: it pushes and pops its own tasks LIFO and idle
+// workers steal FIFO from the others. Tasks submitted from outside the pool
+// are spread round-robin over the worker deques.
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+    
+    // worker_count 0 uses one worker per hardware thread besides the caller
+    explicit TaskScheduler(size_t worker_count = 0);
+    virtual ~TaskScheduler();
+    
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+    
+    static TaskScheduler& instance();
+    // Scheduler for parallel work started on the calling thread: the one it
+    // is a worker of or was bound to, instance() otherwise
+    static TaskScheduler& current();
+    // Binds the calling thread to a scheduler, nullptr to unbind. Returns
+    // the previous binding.
+    static TaskScheduler* bindThread(TaskScheduler* scheduler);
+    
+    void submit(Task task);
+    
+    // Calls body(chunk_begin, chunk_end) over [begin, end) in parallel and
+    // returns when every chunk is done. grain 0 picks a chunk size that
+    // gives each worker a few chunks to balance uneven work.
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body, size_t grain = 0);
+    
+    size_t getWorkerCount() const { return workers_.size(); }
+    size_t getPendingCount() const { return queued_.load(std::memory_order_acquire); }
+    
+    // Index of the calling worker in this scheduler, -1 for other threads
+    int getCurrentWorker() const;
+    
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> next_queue_;
+    std::atomic<size_t> sleeping_;
+    std::atomic<bool> stopping_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_cv_;
+    
+    void workerLoop(size_t index);
+    bool takeTask(size_t index, Task& task);
+    
+    static const int IDLE_SPINS = 64;
+};
+
+// Set of tasks that can be waited on together. wait() runs the group's own
+// tasks that no worker has started yet on the waiting thread, sleeps until
+// the others are done and rethrows the first exception thrown by one of
+// them. It never picks up unrelated work, so a waiting thread holds at most
+// what it was already doing.
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance());
+    virtual ~TaskGroup();
+    
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    
+    void run(TaskScheduler::Task task);
+    void wait();
+    bool isDone() const;
+    
+private:
+    // Shared with the scheduler tasks, which may run after the group is gone
+    struct State {
+        std::mutex mutex;
+        std::condition_variable changed_cv;
+        std::deque<TaskScheduler::Task> queued;  // Not started by a worker or the waiter yet
+        size_t pending = 0;                      // Not finished yet
+        std::exception_ptr error;
+    };
+    
+    TaskScheduler& scheduler_;
+    std::shared_ptr<State> state_;
+    
+    static bool runQueued(State& state);
+};
+
+#endif // TASK_SCHEDULER_H
@@ -0,0 +1,67 @@
+#ifndef THUMBNAIL_RENDERER_H
+#define THUMBNAIL_RENDERER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+struct ThumbnailOptions {
+    int size = 256;                  // Square image, pixels per side
+    float point_color[4] = {0.1f, 0.1f, 0.1f, 1.0f};
+    float background[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    size_t batch_points = 65536;     // Points drawn per batch, bounds memory per worker
+    unsigned workers = 0;            // Documents rendered at once, 0 for one per hardware thread
+};
+
+enum class ThumbnailStatus {
+    RENDERED,
+    CACHED,  // An image for the same content and options already existed
+    FAILED
+};
+
+struct ThumbnailResult {
+    std::string document_path;
+    std::string image_path;
+    uint64_t hash = 0;
+    size_t points = 0;  // Points drawn, 0 for cached images
+    ThumbnailStatus status = ThumbnailStatus::FAILED;
+};
+
+// Offscreen thumbnails of Document2D JSON files, rendered with the
+// SoftwareRenderer. Documents are streamed twice, once for their bounds
+// and once to draw them in batches, so memory per document does not depend
+// on its size. Images are cached as <cache>/<hash>.png, keyed by a 64-bit
+// FNV-1a hash of the file contents and the options; files whose image
+// exists are only hashed.
+class ThumbnailRenderer {
+public:
+    static const size_t READ_BLOCK = 65536;
+    
+    ThumbnailRenderer(const std::string& cache_directory, const ThumbnailOptions& options = ThumbnailOptions());
+    
+    const std::string& getCacheDirectory() const { return cache_directory_; }
+    const ThumbnailOptions& getOptions() const { return options_; }
+    
+    ThumbnailResult renderFile(const std::string& document_path) const;
+    // All .json files below the directory, one document per worker thread at
+    // a time. Writes <cache>/index.txt mapping hashes to documents. Results
+    // follow the sorted document paths.
+    std::vector<ThumbnailResult> renderDirectory(const std::string& directory, bool recursive = true) const;
+    
+    // Calls point(x, y) for every point object of a Document2D JSON file,
+    // reading READ_BLOCK bytes at a time. False if the file cannot be read.
+    static bool streamPoints(const std::string& path, const std::function<void(double, double)>& point);
+    // FNV-1a over the file contents, continuing from seed. False if the file cannot be read.
+    static bool hashFile(const std::string& path, uint64_t seed, uint64_t& hash);
+    
+private:
+    std::string cache_directory_;
+    ThumbnailOptions options_;
+    
+    uint64_t optionsHash() const;
+    std::string imagePath(uint64_t hash) const;
+};
+
+#endif // THUMBNAIL_RENDERER_H
@@ -2,27 +2,30 @@
 #define VALUE_H
 
 #include "Solution.h"
+#include "ValueData.h"
 #include <string>
-#include <variant>
+#include <string_view>
 #include <memory>
 
+// Solution wrapper around a 16-byte ValueData. Hot paths (expressions,
+// columns) work on ValueData directly and never construct a Value.
 class Value : public Solution {
 public:
     Value();
+    explicit Value(const ValueData& data);
+    Value(const Value& other);
+    Value& operator=(const Value& other);
     virtual ~Value() = default;
     
     // Value type management
-    enum class ValueType {
-        INTEGER,
-        DOUBLE,
-        STRING,
-        BOOLEAN,
-        POINTER,
-        UNDEFINED
-    };
-    
-    ValueType getType() const { return type_; }
-    void setType(ValueType type) { type_ = type; }
+    using ValueType = ValueData::Type;
+    
+    ValueType getType() const { return data_.getType(); }
+    void setType(ValueType type) { convertTo(type); }
+    
+    // Compact representation
+    const ValueData& getData() const { return data_; }
+    void setData(const ValueData& data) { data_ = data; invalidateCache(); }
     
     // Value data access
     void setInt(int value);
@@ -43,6 +46,12 @@ public:
     int toInt() const;
     double toDouble() const;
     
+    // Optional cache of the last conversions, for values that are printed
+    // or exported repeatedly. Invalidated whenever the value changes.
+    void setConversionCacheEnabled(bool enabled);
+    bool isConversionCacheEnabled() const { return conversion_cache_enabled_; }
+    std::string_view toStringView() const;
+    
     // Value validation
     bool isValid() const;
     void clear();
@@ -58,13 +67,35 @@ public:
     Value operator*(const Value& other) const;
     Value operator/(const Value& other) const;
     
+    // Implementation of pure virtual methods from Solution
+    virtual void solve() override;
+    virtual void new_solution() override;
+    virtual void delete_solution() override;
+    virtual void copy() override;
+    virtual void duplication() override;
+    virtual void propagation() override;
+    virtual void similar_make() override;
+    
 protected:
-    ValueType type_;
-    std::variant<int, double, std::string, bool, void*> data_;
+    ValueData data_;
+    
+    // Conversion cache
+    bool conversion_cache_enabled_;
+    mutable uint8_t cached_flags_;
+    mutable int cached_int_;
+    mutable double cached_double_;
+    mutable std::string cached_string_;
+    
+    void invalidateCache() { cached_flags_ = 0; }
     
     // Helper methods for type conversion
     void convertTo(ValueType target_type);
     bool canConvertTo(ValueType target_type) const;
+    
+private:
+    static const uint8_t CACHED_INT = 1;
+    static const uint8_t CACHED_DOUBLE = 2;
+    static const uint8_t CACHED_STRING = 4;
 };
 
 #endif // VALUE_H
@@ -0,0 +1,97 @@
+#ifndef VALUE_COLUMN_H
+#define VALUE_COLUMN_H
+
+#include "ValueData.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Homogeneous column of values with a null bitmap. Element-wise kernels run
+// over contiguous arrays (vectorized by the compiler) and follow the same
+// promotion rules as Value: int op int -> int, numeric mix -> double,
+// string + anything -> concatenation, unsupported operands or division by
+// zero -> null.
+class ValueColumn {
+public:
+    using Type = ValueData::Type;
+    
+    ValueColumn();
+    explicit ValueColumn(Type type);
+    
+    static ValueColumn fromInts(const std::vector<int>& values);
+    static ValueColumn fromDoubles(const std::vector<double>& values);
+    static ValueColumn fromBools(const std::vector<bool>& values);
+    static ValueColumn fromStrings(const std::vector<std::string>& values);
+    static ValueColumn nulls(Type type, size_t size);
+    
+    Type getType() const { return type_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void reserve(size_t size);
+    void clear();
+    
+    // Element access
+    void append(const ValueData& value);
+    void appendNull();
+    // Long strings come back as views into the column's character buffer,
+    // valid until the column is modified or destroyed
+    ValueData get(size_t index) const;
+    bool isNull(size_t index) const { return (null_bits_[index >> 6] >> (index & 63)) & 1; }
+    size_t getNullCount() const;
+    
+    // Raw typed storage
+    const int* intData() const { return ints_.data(); }
+    const double* doubleData() const { return doubles_.data(); }
+    const uint8_t* boolData() const { return bools_.data(); }
+    std::string_view stringAt(size_t index) const;
+    
+    // Arithmetic kernels
+    static ValueColumn add(const ValueColumn& a, const ValueColumn& b);
+    static ValueColumn subtract(const ValueColumn& a, const ValueColumn& b);
+    static ValueColumn multiply(const ValueColumn& a, const ValueColumn& b);
+    static ValueColumn divide(const ValueColumn& a, const ValueColumn& b);
+    
+    // Comparison kernels, produce BOOLEAN columns
+    static ValueColumn equal(const ValueColumn& a, const ValueColumn& b);
+    static ValueColumn notEqual(const ValueColumn& a, const ValueColumn& b);
+    static ValueColumn less(const ValueColumn& a, const ValueColumn& b);
+    static ValueColumn greater(const ValueColumn& a, const ValueColumn& b);
+    
+    // Conversion kernel, same rules as ValueData::toInt/toDouble/toBool/toString
+    ValueColumn cast(Type target) const;
+    
+private:
+    enum class Operation {
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE
+    };
+    
+    enum class Comparison {
+        EQUAL,
+        NOT_EQUAL,
+        LESS,
+        GREATER
+    };
+    
+    Type type_;
+    size_t size_;
+    std::vector<uint64_t> null_bits_;  // 1 = null
+    std::vector<int> ints_;
+    std::vector<double> doubles_;
+    std::vector<uint8_t> bools_;
+    std::vector<uint32_t> string_offsets_;  // size_ + 1 entries
+    std::string string_chars_;
+    
+    void resize(size_t size);
+    void setNull(size_t index) { null_bits_[index >> 6] |= uint64_t(1) << (index & 63); }
+    void combineNulls(const ValueColumn& a, const ValueColumn& b);
+    
+    static ValueColumn arithmetic(const ValueColumn& a, const ValueColumn& b, Operation operation);
+    static ValueColumn compare(const ValueColumn& a, const ValueColumn& b, Comparison comparison);
+    static ValueColumn concatenate(const ValueColumn& a, const ValueColumn& b);
+};
+
+#endif // VALUE_COLUMN_H
@@ -0,0 +1,166 @@
+#ifndef VALUE_DATA_H
+#define VALUE_DATA_H
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Process-wide pool of immutable strings. Interned strings are never freed,
+// so their addresses stay valid and equal strings share one allocation.
+// Meant for a bounded set of texts such as literals and names.
+class StringInterner {
+public:
+    static const std::string* intern(std::string_view text);
+    static size_t getInternedCount();
+};
+
+// 16-byte tagged value used on hot paths (expression evaluation, columns).
+// Strings of up to 14 bytes are stored inline. Longer ones live in a
+// reference-counted heap block shared by copies, or in the StringInterner
+// when created with fromInternedString().
+class ValueData {
+public:
+    enum class Type : uint8_t {
+        INTEGER,
+        DOUBLE,
+        STRING,
+        BOOLEAN,
+        POINTER,
+        UNDEFINED
+    };
+    
+    static const size_t INLINE_CAPACITY = 14;
+    
+    ValueData() : type_(Type::UNDEFINED), length_(0) { std::memset(bytes_, 0, sizeof(bytes_)); }
+    ValueData(const ValueData& other) { copyFrom(other); retain(); }
+    ValueData(ValueData&& other) noexcept { copyFrom(other); other.reset(); }
+    ~ValueData() { release(); }
+    
+    ValueData& operator=(const ValueData& other) {
+        other.retain();
+        release();
+        copyFrom(other);
+        return *this;
+    }
+    ValueData& operator=(ValueData&& other) noexcept {
+        if (this != &other) {
+            release();
+            copyFrom(other);
+            other.reset();
+        }
+        return *this;
+    }
+    
+    static ValueData fromInt(int value) { return make(Type::INTEGER, value); }
+    static ValueData fromDouble(double value) { return make(Type::DOUBLE, value); }
+    static ValueData fromBool(bool value) { return make(Type::BOOLEAN, value); }
+    static ValueData fromPointer(void* value) { return make(Type::POINTER, value); }
+    static ValueData fromString(std::string_view value);
+    // Long strings are interned: for literals and names, not computed text
+    static ValueData fromInternedString(std::string_view value);
+    // Long strings are borrowed, the caller keeps the characters alive for
+    // as long as the value and its copies are used
+    static ValueData fromStringView(std::string_view value);
+    
+    Type getType() const { return type_; }
+    bool isValid() const { return type_ != Type::UNDEFINED; }
+    bool isNumeric() const { return type_ == Type::INTEGER || type_ == Type::DOUBLE; }
+    bool isInlineString() const { return type_ == Type::STRING && length_ <= INLINE_CAPACITY; }
+    
+    // Raw access, only meaningful for the matching type
+    int asInt() const { return load<int>(); }
+    double asDouble() const { return load<double>(); }
+    bool asBool() const { return load<bool>(); }
+    void* asPointer() const { return load<void*>(); }
+    std::string_view asString() const;
+    
+    // Conversions, same rules as Value::getInt/getDouble/getBool/getString.
+    // Never throw and never allocate (except toString for the result).
+    int toInt() const;
+    double toDouble() const;
+    bool toBool() const;
+    std::string toString() const;
+    void appendTo(std::string& out) const;
+    
+    // Text parsing used by the conversions: leading whitespace and a '+'
+    // sign are accepted, trailing characters are ignored, failures give 0
+    static int parseInt(std::string_view text);
+    static double parseDouble(std::string_view text);
+    static bool parseBool(std::string_view text);
+    
+    // Arithmetic following Value's promotion rules: int op int -> int,
+    // numeric mix -> double, string + anything -> concatenation,
+    // division by zero and unsupported operands -> UNDEFINED
+    static ValueData add(const ValueData& a, const ValueData& b);
+    static ValueData subtract(const ValueData& a, const ValueData& b);
+    static ValueData multiply(const ValueData& a, const ValueData& b);
+    static ValueData divide(const ValueData& a, const ValueData& b);
+    
+    // int op int as the operations above compute it: wraps around on
+    // overflow, and x / -1 negates so INT_MIN / -1 does not trap.
+    // divideInts needs a non-zero divisor.
+    static int addInts(int a, int b) { return static_cast<int>(static_cast<unsigned>(a) + static_cast<unsigned>(b)); }
+    static int subtractInts(int a, int b) { return static_cast<int>(static_cast<unsigned>(a) - static_cast<unsigned>(b)); }
+    static int multiplyInts(int a, int b) { return static_cast<int>(static_cast<unsigned>(a) * static_cast<unsigned>(b)); }
+    static int divideInts(int a, int b) { return b == -1 ? subtractInts(0, a) : a / b; }
+    
+private:
+    // length_ values past INLINE_CAPACITY mark out-of-line strings
+    static const uint8_t INTERNED_LENGTH = 0xFF;
+    static const uint8_t SHARED_LENGTH = 0xFE;
+    static const uint8_t VIEW_LENGTH = 0xFD;  // Pointer, then a 32-bit length
+    
+    // Heap block of a long string, the characters follow the header
+    struct SharedString {
+        std::atomic<uint32_t> references;
+        size_t length;
+        const char* text() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+    
+    alignas(8) char bytes_[INLINE_CAPACITY];
+    Type type_;
+    uint8_t length_;
+    
+    void copyFrom(const ValueData& other) {
+        std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+        type_ = other.type_;
+        length_ = other.length_;
+    }
+    void reset() {
+        type_ = Type::UNDEFINED;
+        length_ = 0;
+    }
+    void retain() const {
+        if (length_ == SHARED_LENGTH) {
+            load<SharedString*>()->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void release() {
+        if (length_ == SHARED_LENGTH) {
+            releaseShared(load<SharedString*>());
+        }
+    }
+    static void releaseShared(SharedString* shared);
+    
+    template<typename T>
+    static ValueData make(Type type, T value) {
+        static_assert(sizeof(T) <= INLINE_CAPACITY, "payload must fit inline");
+        ValueData data;
+        data.type_ = type;
+        std::memcpy(data.bytes_, &value, sizeof(T));
+        return data;
+    }
+    
+    template<typename T>
+    T load() const {
+        T value;
+        std::memcpy(&value, bytes_, sizeof(T));
+        return value;
+    }
+};
+
+static_assert(sizeof(ValueData) == 16, "ValueData must stay 16 bytes");
+
+#endif // VALUE_DATA_H
@@ -0,0 +1,180 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+struct Vertex3D {
+    float x, y, z;
+    float r, g, b, a;
+    float nx, ny, nz;
+};
+
+// Packed GPU vertex formats, chosen per batch. Vertex3D stays the
+// authoring format; it is converted when geometry is uploaded.
+enum class VertexLayout : uint8_t {
+    POSITION,               // 12 bytes, one uniform color for the batch
+    POSITION_COLOR,         // 16 bytes, RGBA8 color
+    POSITION_NORMAL_COLOR   // 20 bytes, octahedral normal (2 x snorm16) + RGBA8
+};
+
+struct VertexP {
+    float x, y, z;
+};
+
+struct VertexPC {
+    float x, y, z;
+    uint32_t rgba;
+};
+
+struct VertexPNC {
+    float x, y, z;
+    int16_t normal[2];
+    uint32_t rgba;
+};
+
+static_assert(sizeof(VertexP) == 12, "VertexP must stay 12 bytes");
+static_assert(sizeof(VertexPC) == 16, "VertexPC must stay 16 bytes");
+static_assert(sizeof(VertexPNC) == 20, "VertexPNC must stay 20 bytes");
+
+inline size_t getVertexStride(VertexLayout layout) {
+    switch (layout) {
+        case VertexLayout::POSITION: return sizeof(VertexP);
+        case VertexLayout::POSITION_COLOR: return sizeof(VertexPC);
+        default: return sizeof(VertexPNC);
+    }
+}
+
+// Bytes in memory order R, G, B, A, as glColorPointer(4, GL_UNSIGNED_BYTE) reads them
+inline uint32_t packColor(float r, float g, float b, float a) {
+    auto channel = [](float value) {
+        return static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    };
+    uint8_t bytes[4] = {
+        static_cast<uint8_t>(channel(r)), static_cast<uint8_t>(channel(g)),
+        static_cast<uint8_t>(channel(b)), static_cast<uint8_t>(channel(a))
+    };
+    uint32_t rgba;
+    std::memcpy(&rgba, bytes, sizeof(rgba));
+    return rgba;
+}
+
+inline void unpackColor(uint32_t rgba, float& r, float& g, float& b, float& a) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &rgba, sizeof(bytes));
+    r = bytes[0] / 255.0f;
+    g = bytes[1] / 255.0f;
+    b = bytes[2] / 255.0f;
+    a = bytes[3] / 255.0f;
+}
+
+// Octahedral normal encoding: project on the octahedron |x|+|y|+|z| = 1,
+// fold the lower half over the diagonals and store x, y as snorm16
+inline void encodeNormal(float nx, float ny, float nz, int16_t out[2]) {
+    float length = std::fabs(nx) + std::fabs(ny) + std::fabs(nz);
+    if (length == 0.0f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float x = nx / length;
+    float y = ny / length;
+    if (nz < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = static_cast<int16_t>(std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+    out[1] = static_cast<int16_t>(std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline void decodeNormal(const int16_t in[2], float& nx, float& ny, float& nz) {
+    float x = in[0] / 32767.0f;
+    float y = in[1] / 32767.0f;
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    float length = std::sqrt(x * x + y * y + z * z);
+    if (length == 0.0f) {
+        nx = ny = nz = 0.0f;
+        return;
+    }
+    nx = x / length;
+    ny = y / length;
+    nz = z / length;
+}
+
+// Smallest layout that represents the vertices: POSITION when all share
+// one color (returned in uniform_color) and none has a normal
+inline VertexLayout chooseVertexLayout(const Vertex3D* vertices, size_t count, uint32_t& uniform_color) {
+    uniform_color = count > 0 ? packColor(vertices[0].r, vertices[0].g, vertices[0].b, vertices[0].a) : 0xFFFFFFFF;
+    VertexLayout layout = VertexLayout::POSITION;
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex3D& vertex = vertices[i];
+        if (vertex.nx != 0.0f || vertex.ny != 0.0f || vertex.nz != 0.0f) {
+            return VertexLayout::POSITION_NORMAL_COLOR;
+        }
+        if (layout == VertexLayout::POSITION &&
+            packColor(vertex.r, vertex.g, vertex.b, vertex.a) != uniform_color) {
+            layout = VertexLayout::POSITION_COLOR;
+        }
+    }
+    return layout;
+}
+
+// Convert count vertices into out, which holds count * getVertexStride(layout) bytes
+inline void encodeVertices(VertexLayout layout, const Vertex3D* vertices, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex3D& vertex = vertices[i];
+        if (layout == VertexLayout::POSITION) {
+            VertexP packed{vertex.x, vertex.y, vertex.z};
+            std::memcpy(out + i * sizeof(VertexP), &packed, sizeof(packed));
+        } else if (layout == VertexLayout::POSITION_COLOR) {
+            VertexPC packed{vertex.x, vertex.y, vertex.z, packColor(vertex.r, vertex.g, vertex.b, vertex.a)};
+            std::memcpy(out + i * sizeof(VertexPC), &packed, sizeof(packed));
+        } else {
+            VertexPNC packed{vertex.x, vertex.y, vertex.z, {0, 0}, packColor(vertex.r, vertex.g, vertex.b, vertex.a)};
+            encodeNormal(vertex.nx, vertex.ny, vertex.nz, packed.normal);
+            std::memcpy(out + i * sizeof(VertexPNC), &packed, sizeof(packed));
+        }
+    }
+}
+
+// Inverse of encodeVertices, POSITION vertices get uniform_color
+inline Vertex3D decodeVertex(VertexLayout layout, const uint8_t* data, uint32_t uniform_color) {
+    Vertex3D vertex{};
+    uint32_t rgba = uniform_color;
+    if (layout == VertexLayout::POSITION) {
+        VertexP packed;
+        std::memcpy(&packed, data, sizeof(packed));
+        vertex.x = packed.x;
+        vertex.y = packed.y;
+        vertex.z = packed.z;
+    } else if (layout == VertexLayout::POSITION_COLOR) {
+        VertexPC packed;
+        std::memcpy(&packed, data, sizeof(packed));
+        vertex.x = packed.x;
+        vertex.y = packed.y;
+        vertex.z = packed.z;
+        rgba = packed.rgba;
+    } else {
+        VertexPNC packed;
+        std::memcpy(&packed, data, sizeof(packed));
+        vertex.x = packed.x;
+        vertex.y = packed.y;
+        vertex.z = packed.z;
+        decodeNormal(packed.normal, vertex.nx, vertex.ny, vertex.nz);
+        rgba = packed.rgba;
+    }
+    unpackColor(rgba, vertex.r, vertex.g, vertex.b, vertex.a);
+    return vertex;
+}
+
+#endif // VERTEX_LAYOUT_H
@@ -1,41 +1,240 @@
 #include "../include/ConstructionHistory.h"
+#include "../include/HistoryJournal.h"
 
 ConstructionStep::ConstructionStep(const std::string& operation, void* data)
     : operation_(operation), data_(data) {
 }
 
-ConstructionHistory::ConstructionHistory() : current_step_index_(0) {
+HistoryNode::HistoryNode(std::shared_ptr<const HistoryNode> parent, std::unique_ptr<ConstructionStep> step)
+    : parent_(std::move(parent)), step_(std::move(step)), depth_(parent_ ? parent_->getDepth() + 1 : 1) {
+}
+
+HistoryNode::~HistoryNode() {
+    // Unlink the chain iteratively so long histories do not recurse on destruction
+    std::shared_ptr<const HistoryNode> parent = std::move(parent_);
+    while (parent && parent.use_count() == 1) {
+        parent = std::move(const_cast<HistoryNode*>(parent.get())->parent_);
+    }
+}
+
+ConstructionHistory::ConstructionHistory()
+    : current_step_index_(0), current_branch_("main"), next_branch_id_(1) {
+    branches_[current_branch_] = nullptr;
 }
 
 void ConstructionHistory::addStep(const std::string& operation, void* data) {
-    // Remove any steps after current index (redo history)
-    steps_.erase(steps_.begin() + current_step_index_, steps_.end());
+    // Keep the redo tail alive as its own branch instead of erasing it
+    if (current_step_index_ < path_.size()) {
+        const auto& old_tip = path_.back();
+        bool referenced = false;
+        for (const auto& branch : branches_) {
+            if (branch.first != current_branch_ && branch.second == old_tip) {
+                referenced = true;
+                break;
+            }
+        }
+        if (!referenced) {
+            branches_[makeBranchName()] = old_tip;
+        }
+        path_.resize(current_step_index_);
+    }
     
-    steps_.push_back(std::make_unique<ConstructionStep>(operation, data));
-    current_step_index_ = steps_.size();
+    std::shared_ptr<const HistoryNode> parent = path_.empty() ? nullptr : path_.back();
+    path_.push_back(std::make_shared<HistoryNode>(
+        std::move(parent), std::make_unique<ConstructionStep>(operation, data)));
+    current_step_index_ = path_.size();
+    branches_[current_branch_] = path_.back();
+    
+    if (journal_) {
+        std::string bytes = step_encoder_ ? step_encoder_(*path_.back()->getStep()) : std::string();
+        journal_->append(HistoryJournal::RecordType::ADD_STEP, journal_stream_, operation, bytes);
+    }
 }
 
 void ConstructionHistory::undo() {
     if (canUndo()) {
-        --current_step_index_;
+        moveCursorTo(current_step_index_ - 1);
+        if (journal_) {
+            journal_->append(HistoryJournal::RecordType::UNDO, journal_stream_);
+        }
     }
 }
 
 void ConstructionHistory::redo() {
     if (canRedo()) {
-        ++current_step_index_;
+        moveCursorTo(current_step_index_ + 1);
+        if (journal_) {
+            journal_->append(HistoryJournal::RecordType::REDO, journal_stream_);
+        }
     }
 }
 
 void ConstructionHistory::clear() {
-    steps_.clear();
+    path_.clear();
+    branches_.clear();
     current_step_index_ = 0;
+    current_branch_ = "main";
+    next_branch_id_ = 1;
+    branches_[current_branch_] = nullptr;
+    
+    if (journal_) {
+        journal_->append(HistoryJournal::RecordType::CLEAR, journal_stream_);
+    }
 }
 
 ConstructionStep* ConstructionHistory::getStep(size_t index) const {
-    if (index < steps_.size()) {
-        return steps_[index].get();
+    if (index < path_.size()) {
+        return path_[index]->getStep();
     }
     return nullptr;
 }
 
+bool ConstructionHistory::createBranch(const std::string& name) {
+    if (name.empty() || hasBranch(name)) {
+        return false;
+    }
+    
+    // The new branch starts at the cursor; the old branch keeps its redo tail
+    path_.resize(current_step_index_);
+    branches_[name] = path_.empty() ? nullptr : path_.back();
+    current_branch_ = name;
+    
+    if (journal_) {
+        journal_->append(HistoryJournal::RecordType::CREATE_BRANCH, journal_stream_, name);
+    }
+    return true;
+}
+
+bool ConstructionHistory::switchToBranch(const std::string& name) {
+    auto it = branches_.find(name);
+    if (it == branches_.end()) {
+        return false;
+    }
+    
+    const HistoryNode* cursor = current_step_index_ > 0 ? path_[current_step_index_ - 1].get() : nullptr;
+    std::shared_ptr<const HistoryNode> target = it->second;
+    const HistoryNode* ancestor = commonAncestor(cursor, target.get());
+    size_t common_depth = ancestor ? ancestor->getDepth() : 0;
+    
+    // Revert the steps that are not shared with the target branch
+    moveCursorTo(common_depth);
+    
+    // Splice in the differing suffix of the target branch
+    std::vector<std::shared_ptr<const HistoryNode>> suffix;
+    for (std::shared_ptr<const HistoryNode> node = target; node.get() != ancestor; node = node->getParentPtr()) {
+        suffix.push_back(node);
+    }
+    path_.resize(common_depth);
+    path_.insert(path_.end(), suffix.rbegin(), suffix.rend());
+    current_branch_ = name;
+    
+    moveCursorTo(path_.size());
+    
+    if (journal_) {
+        journal_->append(HistoryJournal::RecordType::SWITCH_BRANCH, journal_stream_, name);
+    }
+    return true;
+}
+
+bool ConstructionHistory::removeBranch(const std::string& name) {
+    if (name == current_branch_ || branches_.erase(name) == 0) {
+        return false;
+    }
+    
+    if (journal_) {
+        journal_->append(HistoryJournal::RecordType::REMOVE_BRANCH, journal_stream_, name);
+    }
+    return true;
+}
+
+bool ConstructionHistory::hasBranch(const std::string& name) const {
+    return branches_.find(name) != branches_.end();
+}
+
+std::vector<std::string> ConstructionHistory::getBranchNames() const {
+    std::vector<std::string> result;
+    for (const auto& branch : branches_) {
+        result.push_back(branch.first);
+    }
+    return result;
+}
+
+size_t ConstructionHistory::getBranchStepCount(const std::string& name) const {
+    auto it = branches_.find(name);
+    if (it == branches_.end() || !it->second) {
+        return 0;
+    }
+    return it->second->getDepth();
+}
+
+size_t ConstructionHistory::getCommonStepCount(const std::string& first, const std::string& second) const {
+    auto a = branches_.find(first);
+    auto b = branches_.find(second);
+    if (a == branches_.end() || b == branches_.end()) {
+        return 0;
+    }
+    const HistoryNode* ancestor = commonAncestor(a->second.get(), b->second.get());
+    return ancestor ? ancestor->getDepth() : 0;
+}
+
+void ConstructionHistory::setReplayHandlers(StepHandler revert, StepHandler apply) {
+    revert_handler_ = std::move(revert);
+    apply_handler_ = std::move(apply);
+}
+
+void ConstructionHistory::setStepCodec(StepEncoder encode, StepDecoder decode) {
+    step_encoder_ = std::move(encode);
+    step_decoder_ = std::move(decode);
+}
+
+void ConstructionHistory::recoverStep(const std::string& operation, const std::string& bytes) {
+    addStep(operation, step_decoder_ ? step_decoder_(operation, bytes) : nullptr);
+    if (apply_handler_) {
+        apply_handler_(*path_.back()->getStep());
+    }
+}
+
+void ConstructionHistory::renameJournalStream(const std::string& stream) {
+    if (!journal_ || stream == journal_stream_) {
+        return;
+    }
+    journal_->append(HistoryJournal::RecordType::RENAME_STREAM, journal_stream_, stream);
+    journal_stream_ = stream;
+}
+
+std::string ConstructionHistory::makeBranchName() {
+    std::string name;
+    do {
+        name = "branch-" + std::to_string(next_branch_id_++);
+    } while (hasBranch(name));
+    return name;
+}
+
+void ConstructionHistory::moveCursorTo(size_t index) {
+    while (current_step_index_ > index) {
+        --current_step_index_;
+        if (revert_handler_) {
+            revert_handler_(*path_[current_step_index_]->getStep());
+        }
+    }
+    while (current_step_index_ < index && current_step_index_ < path_.size()) {
+        if (apply_handler_) {
+            apply_handler_(*path_[current_step_index_]->getStep());
+        }
+        ++current_step_index_;
+    }
+}
+
+const HistoryNode* ConstructionHistory::commonAncestor(const HistoryNode* a, const HistoryNode* b) {
+    while (a && b && a != b) {
+        if (a->getDepth() > b->getDepth()) {
+            a = a->getParent();
+        } else if (b->getDepth() > a->getDepth()) {
+            b = b->getParent();
+        } else {
+            a = a->getParent();
+            b = b->getParent();
+        }
+    }
+    return (a && b) ? a : nullptr;
+}
@@ -0,0 +1,288 @@
+#include "../include/CullingStage.h"
+#include "../include/TaskScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+ClipTransform::ClipTransform(const float* projection, const float* model_view) {
+    multiply(projection, model_view, mvp);
+}
+
+void ClipTransform::multiply(const float* a, const float* b, float* out) {
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            out[column * 4 + row] = sum;
+        }
+    }
+}
+
+float ClipTransform::projectedExtent(double min_x, double min_y, double max_x, double max_y, int width, int height) const {
+    float screen_min_x = std::numeric_limits<float>::max();
+    float screen_min_y = std::numeric_limits<float>::max();
+    float screen_max_x = std::numeric_limits<float>::lowest();
+    float screen_max_y = std::numeric_limits<float>::lowest();
+    for (int corner = 0; corner < 4; ++corner) {
+        float x = static_cast<float>((corner & 1) ? max_x : min_x);
+        float y = static_cast<float>((corner & 2) ? max_y : min_y);
+        float clip_x = mvp[0] * x + mvp[4] * y + mvp[12];
+        float clip_y = mvp[1] * x + mvp[5] * y + mvp[13];
+        float clip_w = mvp[3] * x + mvp[7] * y + mvp[15];
+        if (clip_w <= 0.0f) {
+            return std::numeric_limits<float>::max();
+        }
+        float screen_x = (clip_x / clip_w * 0.5f + 0.5f) * width;
+        float screen_y = (clip_y / clip_w * 0.5f + 0.5f) * height;
+        screen_min_x = std::min(screen_min_x, screen_x);
+        screen_min_y = std::min(screen_min_y, screen_y);
+        screen_max_x = std::max(screen_max_x, screen_x);
+        screen_max_y = std::max(screen_max_y, screen_y);
+    }
+    return std::max(screen_max_x - screen_min_x, screen_max_y - screen_min_y);
+}
+
+Frustum Frustum::fromMatrices(const float* projection, const float* model_view) {
+    return fromTransform(ClipTransform(projection, model_view));
+}
+
+Frustum Frustum::fromTransform(const ClipTransform& transform) {
+    const float* m = transform.mvp;
+    
+    // Gribb-Hartmann: each plane is row 3 plus or minus row 0, 1 or 2
+    Frustum frustum;
+    for (int i = 0; i < 6; ++i) {
+        int row = i / 2;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        for (int k = 0; k < 4; ++k) {
+            frustum.planes[i][k] = m[k * 4 + 3] + sign * m[k * 4 + row];
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsBox(float min_x, float min_y, float min_z, float max_x, float max_y, float max_z) const {
+    // Outside as soon as the corner furthest along a plane normal is behind it
+    for (const float* plane : planes) {
+        float x = plane[0] >= 0.0f ? max_x : min_x;
+        float y = plane[1] >= 0.0f ? max_y : min_y;
+        float z = plane[2] >= 0.0f ? max_z : min_z;
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::containsBox(float min_x, float min_y, float min_z, float max_x, float max_y, float max_z) const {
+    // Inside as long as the corner nearest along every plane normal is in front of it
+    for (const float* plane : planes) {
+        float x = plane[0] >= 0.0f ? min_x : max_x;
+        float y = plane[1] >= 0.0f ? min_y : max_y;
+        float z = plane[2] >= 0.0f ? min_z : max_z;
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CullingStage::CullingStage()
+    : max_screen_error_(1.0f), color_{0, 0, 0, 1.0f, 1.0f, 1.0f, 1.0f, 0, 0, 0}, cull_count_(0) {
+}
+
+void CullingStage::setPointColor(float r, float g, float b, float a) {
+    color_.r = r;
+    color_.g = g;
+    color_.b = b;
+    color_.a = a;
+}
+
+const std::vector<Vertex3D>& CullingStage::cull(const PointStore& points, const OpenGLRenderer& renderer) {
+    stats_ = CullStats();
+    selections_.clear();
+    ++cull_count_;
+    
+    ClipTransform transform(renderer.getProjectionMatrix(), renderer.getModelViewMatrix());
+    Frustum frustum = Frustum::fromTransform(transform);
+    int width = renderer.getViewportWidth();
+    int height = renderer.getViewportHeight();
+    
+    // Refreshes chunk bounds left dirty by point edits
+    double min_x, min_y, max_x, max_y;
+    points.getBounds(min_x, min_y, max_x, max_y);
+    
+    // Select per chunk; cheap, and it has to touch the cache map anyway
+    size_t vertex_count = 0;
+    for (size_t i = 0; i < points.getChunkCount(); ++i) {
+        const PointChunk& chunk = points.getChunk(i);
+        if (chunk.live == 0) {
+            continue;
+        }
+        stats_.chunks_tested++;
+        if (!frustum.intersectsBox(static_cast<float>(chunk.min_x), static_cast<float>(chunk.min_y), 0.0f,
+                                   static_cast<float>(chunk.max_x), static_cast<float>(chunk.max_y), 0.0f)) {
+            stats_.chunks_culled++;
+            auto it = lods_.find(&chunk);
+            if (it != lods_.end()) {
+                it->second.last_cull = cull_count_;
+            }
+            continue;
+        }
+        stats_.points_visible += chunk.live;
+        
+        // Coarsest grid whose cells stay within the allowed screen error
+        bool inside = frustum.containsBox(static_cast<float>(chunk.min_x), static_cast<float>(chunk.min_y), 0.0f,
+                                          static_cast<float>(chunk.max_x), static_cast<float>(chunk.max_y), 0.0f);
+        Selection selection{&chunk, nullptr, -1, vertex_count, 0, inside};
+        float extent = transform.projectedExtent(chunk.min_x, chunk.min_y, chunk.max_x, chunk.max_y, width, height);
+        int resolution = LOD_BASE_RESOLUTION;
+        for (int level = 0; level < LOD_LEVELS; ++level, resolution *= 4) {
+            size_t cells = static_cast<size_t>(resolution) * resolution;
+            if (extent / resolution <= max_screen_error_ && cells < chunk.live) {
+                selection.level = level;
+                break;
+            }
+        }
+        
+        if (selection.level >= 0) {
+            ChunkLod& lod = lods_[&chunk];
+            if (!lod.built || lod.version != chunk.version) {
+                lod.version = chunk.version;
+                lod.built = false;
+            }
+            lod.last_cull = cull_count_;
+            selection.lod = &lod;
+        }
+        selections_.push_back(selection);
+        vertex_count += chunk.live;  // Upper bound until the LOD is built
+    }
+    
+    // Build missing representative sets in parallel, each task owns its entries
+    TaskScheduler& scheduler = TaskScheduler::current();
+    scheduler.parallelFor(0, selections_.size(), [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Selection& selection = selections_[i];
+            if (selection.lod && !selection.lod->built) {
+                buildLod(*selection.chunk, *selection.lod);
+            }
+        }
+    }, 1);
+    
+    vertex_count = 0;
+    for (Selection& selection : selections_) {
+        selection.first_vertex = vertex_count;
+        if (selection.lod) {
+            vertex_count += selection.lod->levels[selection.level].size() / 2;
+            stats_.chunks_decimated++;
+        } else {
+            vertex_count += selection.chunk->live;
+        }
+    }
+    
+    // Each selection writes into its reserved range, keeping only points in
+    // the frustum unless the whole chunk is
+    vertices_.resize(vertex_count);
+    scheduler.parallelFor(0, selections_.size(), [this, &frustum](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Selection& selection = selections_[i];
+            Vertex3D* out = vertices_.data() + selection.first_vertex;
+            Vertex3D* first = out;
+            if (selection.lod) {
+                const std::vector<float>& xy = selection.lod->levels[selection.level];
+                for (size_t k = 0; k < xy.size(); k += 2) {
+                    if (!selection.inside && !frustum.containsPoint(xy[k], xy[k + 1], 0.0f)) {
+                        continue;
+                    }
+                    *out = color_;
+                    out->x = xy[k];
+                    out->y = xy[k + 1];
+                    ++out;
+                }
+                selection.vertex_count = out - first;
+                continue;
+            }
+            const PointChunk& chunk = *selection.chunk;
+            for (size_t k = 0; k < chunk.points.size(); ++k) {
+                if (chunk.isDead(k)) {
+                    continue;
+                }
+                float x = static_cast<float>(chunk.points[k].getX());
+                float y = static_cast<float>(chunk.points[k].getY());
+                if (!selection.inside && !frustum.containsPoint(x, y, 0.0f)) {
+                    continue;
+                }
+                *out = color_;
+                out->x = x;
+                out->y = y;
+                ++out;
+            }
+            selection.vertex_count = out - first;
+        }
+    }, 1);
+    
+    // Close the gaps the rejected points left
+    size_t written = 0;
+    for (const Selection& selection : selections_) {
+        if (written != selection.first_vertex) {
+            std::copy(vertices_.begin() + selection.first_vertex,
+                      vertices_.begin() + selection.first_vertex + selection.vertex_count,
+                      vertices_.begin() + written);
+        }
+        written += selection.vertex_count;
+    }
+    vertices_.resize(written);
+    stats_.points_submitted = written;
+    
+    // Forget chunks that are gone from the store or were rewritten
+    for (auto it = lods_.begin(); it != lods_.end();) {
+        if (it->second.last_cull != cull_count_) {
+            it = lods_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return vertices_;
+}
+
+void CullingStage::draw(const PointStore& points, OpenGLRenderer& renderer) {
+    RenderStats& render_stats = renderer.getRenderStats();
+    {
+        RenderStageTimer timer(render_stats, RenderStage::CULL);
+        cull(points, renderer);
+    }
+    render_stats.addCulling(stats_.chunks_tested, stats_.chunks_culled, stats_.points_visible, stats_.points_submitted);
+    if (!vertices_.empty()) {
+        renderer.drawPoints(vertices_);
+    }
+}
+
+void CullingStage::buildLod(const PointChunk& chunk, ChunkLod& lod) {
+    // First live point of each occupied grid cell represents the cell
+    double span_x = std::max(chunk.max_x - chunk.min_x, std::numeric_limits<double>::min());
+    double span_y = std::max(chunk.max_y - chunk.min_y, std::numeric_limits<double>::min());
+    int resolution = LOD_BASE_RESOLUTION;
+    std::vector<bool> occupied;
+    for (int level = 0; level < LOD_LEVELS; ++level, resolution *= 4) {
+        std::vector<float>& xy = lod.levels[level];
+        xy.clear();
+        occupied.assign(static_cast<size_t>(resolution) * resolution, false);
+        for (size_t k = 0; k < chunk.points.size(); ++k) {
+            if (chunk.isDead(k)) {
+                continue;
+            }
+            const Point2D& point = chunk.points[k];
+            int cell_x = std::min(static_cast<int>((point.getX() - chunk.min_x) / span_x * resolution), resolution - 1);
+            int cell_y = std::min(static_cast<int>((point.getY() - chunk.min_y) / span_y * resolution), resolution - 1);
+            size_t cell = static_cast<size_t>(cell_y) * resolution + cell_x;
+            if (!occupied[cell]) {
+                occupied[cell] = true;
+                xy.push_back(static_cast<float>(point.getX()));
+                xy.push_back(static_cast<float>(point.getY()));
+            }
+        }
+    }
+    lod.built = true;
+}
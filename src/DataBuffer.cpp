@@ -0,0 +1,56 @@
+#include "../include/DataBuffer.h"
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+
+namespace {
+
+struct RegistryState {
+    std::mutex mutex;
+    std::unordered_map<std::string, DataTypeId> ids;
+    std::vector<std::string> names{""};  // Slot 0 is INVALID_TYPE
+};
+
+RegistryState& registryState() {
+    static RegistryState state;
+    return state;
+}
+
+} // namespace
+
+DataTypeId DataTypeRegistry::registerType(const std::string& name) {
+    if (name.empty()) {
+        return INVALID_TYPE;
+    }
+    
+    RegistryState& state = registryState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto it = state.ids.find(name);
+    if (it != state.ids.end()) {
+        return it->second;
+    }
+    
+    DataTypeId id = static_cast<DataTypeId>(state.names.size());
+    state.names.push_back(name);
+    state.ids.emplace(name, id);
+    return id;
+}
+
+DataTypeId DataTypeRegistry::findType(const std::string& name) {
+    RegistryState& state = registryState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto it = state.ids.find(name);
+    return it != state.ids.end() ? it->second : INVALID_TYPE;
+}
+
+std::string DataTypeRegistry::getTypeName(DataTypeId id) {
+    RegistryState& state = registryState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return id < state.names.size() ? state.names[id] : "";
+}
+
+size_t DataTypeRegistry::getTypeCount() {
+    RegistryState& state = registryState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.names.size() - 1;
+}
@@ -0,0 +1,49 @@
+#include "../include/DataChannel.h"
+#include "../include/Solution.h"
+
+DataChannel::DataChannel(Solution* source, Solution* target, DataTypeId type)
+    : source_(source), target_(target), type_(type), exchange_(nullptr), valid_(false) {
+    if (source_ && target_ && type_ != DataTypeRegistry::INVALID_TYPE) {
+        valid_ = source_->canSendBuffer(type_) && target_->canReceiveBuffer(type_);
+        exchange_ = target_->findDataExchange(type_);
+    }
+}
+
+DataChannel::DataChannel(Solution* source, Solution* target, const std::string& data_type)
+    : DataChannel(source, target, DataTypeRegistry::registerType(data_type)) {
+}
+
+DataBuffer DataChannel::transfer() {
+    if (!valid_) {
+        return DataBuffer();
+    }
+    return send(source_->sendBuffer(type_));
+}
+
+DataBuffer DataChannel::send(const DataBuffer& buffer) {
+    if (!valid_ || buffer.getType() != type_ || !buffer.isValid()) {
+        return DataBuffer();
+    }
+    if (exchange_) {
+        return exchange_->processBuffer(buffer);
+    }
+    return target_->receiveBuffer(buffer);
+}
+
+std::future<DataBuffer> DataChannel::transferAsync() {
+    if (!valid_) {
+        std::promise<DataBuffer> reply;
+        reply.set_value(DataBuffer());
+        return reply.get_future();
+    }
+    return sendAsync(source_->sendBuffer(type_));
+}
+
+std::future<DataBuffer> DataChannel::sendAsync(const DataBuffer& buffer) {
+    if (!valid_ || buffer.getType() != type_ || !buffer.isValid()) {
+        std::promise<DataBuffer> reply;
+        reply.set_value(DataBuffer());
+        return reply.get_future();
+    }
+    return target_->postBuffer(buffer);
+}
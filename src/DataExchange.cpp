@@ -3,6 +3,23 @@
 void DataExchangeInterface::registerDataExchange(DataExchange* exchange) {
     if (exchange) {
         data_exchanges_.push_back(exchange);
+        
+        // First registered exchange wins for each data type
+        for (const auto& data_type : exchange->getSupportedDataTypes()) {
+            DataTypeId id = DataTypeRegistry::registerType(data_type);
+            if (id == DataTypeRegistry::INVALID_TYPE) {
+                continue;
+            }
+            if (id >= dispatch_table_.size()) {
+                dispatch_table_.resize(id + 1, nullptr);
+            }
+            if (!dispatch_table_[id]) {
+                dispatch_table_[id] = exchange;
+            }
+        }
     }
 }
 
+DataExchange* DataExchangeInterface::findDataExchange(const std::string& data_type) const {
+    return findDataExchange(DataTypeRegistry::findType(data_type));
+}
@@ -6,12 +6,14 @@
 #include <cctype>
 
 Document2D::Document2D() 
-    : SolutionDocument(), default_cs_(nullptr), units_("mm"), scale_(1.0), is_open_(false) {
+    : SolutionDocument(), default_cs_(nullptr), units_("mm"), scale_(1.0), is_open_(false),
+      batch_depth_(0), batch_changed_(false) {
     setName("Untitled 2D Document");
 }
 
 Document2D::Document2D(const std::string& name)
-    : SolutionDocument(), default_cs_(nullptr), units_("mm"), scale_(1.0), is_open_(false) {
+    : SolutionDocument(), default_cs_(nullptr), units_("mm"), scale_(1.0), is_open_(false),
+      batch_depth_(0), batch_changed_(false) {
     setName(name);
 }
 
@@ -39,6 +41,7 @@ bool Document2D::load(const std::string& file_path) {
         setPath(file_path);
         setModified(false);
         is_open_ = true;
+        recoverJournal();
     }
     
     return success;
@@ -49,6 +52,7 @@ bool Document2D::save(const std::string& file_path) {
     if (path.empty()) {
         return false;
     }
+    points_.compactIfNeeded();
     
     std::string format;
     if (!detectFileFormat(path, format)) {
@@ -67,6 +71,9 @@ bool Document2D::save(const std::string& file_path) {
     if (success) {
         setPath(path);
         setModified(false);
+        if (journal_) {
+            journal_->checkpoint();
+        }
     }
     
     return success;
@@ -108,13 +115,10 @@ std::unique_ptr<SolutionDocument> Document2D::copy() const {
     copy->setUnits(units_);
     copy->setScale(scale_);
     
-    // Copy points
-    for (const auto& point : points_) {
-        copy->addPoint(*point);
-    }
-    
-    // Copy coordinate system reference
+    // Share point chunks, they are cloned only when one side modifies them
+    copy->points_ = points_;
     copy->setDefaultCoordinateSystem(default_cs_);
+    copy->setModified(!points_.empty());
     
     return copy;
 }
@@ -166,85 +170,123 @@ std::vector<std::string> Document2D::getSupportedExportFormats() const {
 }
 
 void Document2D::addPoint(const Point2D& point) {
-    points_.push_back(std::make_unique<Point2D>(point));
-    setModified(true);
+    points_.append(point);
+    notifyPointsChanged();
 }
 
 void Document2D::addPoint(double x, double y) {
-    Point2D point(x, y, default_cs_);
-    addPoint(point);
+    points_.append(x, y, default_cs_);
+    notifyPointsChanged();
+}
+
+size_t Document2D::addPoints(std::span<const double> xs, std::span<const double> ys) {
+    size_t added = points_.appendCoordinates(xs, ys, default_cs_);
+    if (added > 0) {
+        notifyPointsChanged();
+    }
+    return added;
 }
 
 void Document2D::removePoint(size_t index) {
     if (index < points_.size()) {
-        points_.erase(points_.begin() + index);
-        setModified(true);
+        points_.removeAt(index);
+        if (batch_depth_ == 0) {
+            points_.compactIfNeeded();
+        }
+        notifyPointsChanged();
     }
 }
 
-Point2D* Document2D::getPoint(size_t index) {
-    if (index < points_.size()) {
-        return points_[index].get();
+size_t Document2D::removePoints(const std::vector<bool>& selected) {
+    size_t removed = points_.removeSelection(selected);
+    if (removed > 0) {
+        notifyPointsChanged();
     }
-    return nullptr;
+    return removed;
+}
+
+size_t Document2D::removePoints(const std::vector<size_t>& indices) {
+    size_t removed = points_.removeIndices(indices);
+    if (removed > 0) {
+        notifyPointsChanged();
+    }
+    return removed;
 }
 
 const Point2D* Document2D::getPoint(size_t index) const {
     if (index < points_.size()) {
-        return points_[index].get();
+        return &points_.at(index);
     }
     return nullptr;
 }
 
+Point2D* Document2D::editPoint(size_t index) {
+    return points_.mutableAt(index);
+}
+
 void Document2D::clearPoints() {
     points_.clear();
-    setModified(true);
+    notifyPointsChanged();
+}
+
+void Document2D::beginBatch() {
+    ++batch_depth_;
 }
 
-std::vector<Point2D*> Document2D::getAllPoints() {
-    std::vector<Point2D*> result;
-    for (const auto& point : points_) {
-        result.push_back(point.get());
+void Document2D::endBatch() {
+    if (batch_depth_ == 0 || --batch_depth_ > 0) {
+        return;
+    }
+    // Removals inside the batch only tombstone, settle storage once here
+    points_.compactIfNeeded();
+    if (batch_changed_) {
+        batch_changed_ = false;
+        setModified(true);
+        if (on_points_changed_) {
+            on_points_changed_();
+        }
+    }
+}
+
+void Document2D::notifyPointsChanged() {
+    if (batch_depth_ > 0) {
+        batch_changed_ = true;
+        return;
+    }
+    setModified(true);
+    if (on_points_changed_) {
+        on_points_changed_();
     }
-    return result;
 }
 
 std::vector<const Point2D*> Document2D::getAllPoints() const {
+    // Walk the chunks, indexed lookups would search past tombstones per point
     std::vector<const Point2D*> result;
-    for (const auto& point : points_) {
-        result.push_back(point.get());
+    result.reserve(points_.size());
+    for (size_t c = 0; c < points_.getChunkCount(); ++c) {
+        const PointChunk& chunk = points_.getChunk(c);
+        for (size_t offset = 0; offset < chunk.points.size(); ++offset) {
+            if (!chunk.isDead(offset)) {
+                result.push_back(&chunk.points[offset]);
+            }
+        }
     }
     return result;
 }
 
+std::vector<Point2D*> Document2D::editAllPoints() {
+    return points_.mutablePoints();
+}
+
 void Document2D::setDefaultCoordinateSystem(CS* cs) {
     default_cs_ = cs;
     // Update all points to use this CS
-    for (auto& point : points_) {
-        if (!point->hasCoordinateSystem()) {
-            point->setCoordinateSystem(cs);
-        }
-    }
+    points_.assignMissingCoordinateSystem(cs);
 }
 
 void Document2D::getBoundingBox(double& min_x, double& min_y, double& max_x, double& max_y) const {
-    if (points_.empty()) {
-        min_x = min_y = max_x = max_y = 0.0;
-        return;
-    }
-    
-    min_x = min_y = std::numeric_limits<double>::max();
-    max_x = max_y = std::numeric_limits<double>::lowest();
-    
-    for (const auto& point : points_) {
-        double x = point->getX();
-        double y = point->getY();
-        
-        min_x = std::min(min_x, x);
-        min_y = std::min(min_y, y);
-        max_x = std::max(max_x, x);
-        max_y = std::max(max_y, y);
-    }
+    // Combines the cached per-chunk bounds
+    points_.getBounds(min_x, min_y, max_x, max_y);
 }
 
 bool Document2D::hasBoundingBox() const {
@@ -304,8 +346,9 @@ bool Document2D::saveToJSON(const std::string& file_path) const {
     file << "  \"points\": [\n";
     
     for (size_t i = 0; i < points_.size(); ++i) {
-        file << "    {\"x\": " << points_[i]->getX() 
-             << ", \"y\": " << points_[i]->getY() << "}";
+        const Point2D& point = points_.at(i);
+        file << "    {\"x\": " << point.getX() 
+             << ", \"y\": " << point.getY() << "}";
         if (i < points_.size() - 1) {
             file << ",";
         }
@@ -346,9 +389,10 @@ bool Document2D::saveToXML(const std::string& file_path) const {
     file << "  <scale>" << scale_ << "</scale>\n";
     file << "  <points>\n";
     
-    for (const auto& point : points_) {
-        file << "    <point x=\"" << point->getX() 
-             << "\" y=\"" << point->getY() << "\"/>\n";
+    for (size_t i = 0; i < points_.size(); ++i) {
+        const Point2D& point = points_.at(i);
+        file << "    <point x=\"" << point.getX() 
+             << "\" y=\"" << point.getY() << "\"/>\n";
     }
     
     file << "  </points>\n";
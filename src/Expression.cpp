@@ -0,0 +1,590 @@
+#include "../include/Expression.h"
+#include "../include/Value.h"
+#include "../include/Node.h"
+#include <charconv>
+#include <cctype>
+#include <algorithm>
+
+struct Expression::SyntaxNode {
+    enum class Kind : uint8_t {
+        CONSTANT,
+        VARIABLE,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE
+    };
+    
+    Kind kind = Kind::CONSTANT;
+    ValueData value;
+    size_t variable = 0;
+    size_t depth = 1;  // Height of the subtree, tracked while parsing
+    std::unique_ptr<SyntaxNode> left;
+    std::unique_ptr<SyntaxNode> right;
+};
+
+namespace {
+
+using SyntaxNodePtr = std::unique_ptr<Expression::SyntaxNode>;
+
+void skipSpaces(const std::string& text, size_t& pos) {
+    while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+        ++pos;
+    }
+}
+
+bool isIdentifierStart(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+ValueData applyOperator(Expression::SyntaxNode::Kind kind, const ValueData& a, const ValueData& b) {
+    using Kind = Expression::SyntaxNode::Kind;
+    switch (kind) {
+        case Kind::ADD: return ValueData::add(a, b);
+        case Kind::SUBTRACT: return ValueData::subtract(a, b);
+        case Kind::MULTIPLY: return ValueData::multiply(a, b);
+        case Kind::DIVIDE: return ValueData::divide(a, b);
+        default: return ValueData();
+    }
+}
+
+SyntaxNodePtr makeBinary(Expression::SyntaxNode::Kind kind, SyntaxNodePtr left, SyntaxNodePtr right) {
+    auto node = std::make_unique<Expression::SyntaxNode>();
+    node->kind = kind;
+    node->depth = 1 + std::max(left->depth, right->depth);
+    node->left = std::move(left);
+    node->right = std::move(right);
+    return node;
+}
+
+std::string nestingError(size_t pos) {
+    return "Expression nested too deeply at position " + std::to_string(pos);
+}
+
+// Counts parser recursion while in scope
+class DepthGuard {
+public:
+    explicit DepthGuard(size_t& depth) : depth_(depth) { ++depth_; }
+    ~DepthGuard() { --depth_; }
+    
+private:
+    size_t& depth_;
+};
+
+} // namespace
+
+Expression::Expression()
+    : parse_depth_(0), compiled_(false), result_{RegisterClass::GENERIC, 0}, result_type_(ValueData::Type::UNDEFINED) {
+}
+
+Expression::Expression(const std::string& source) : Expression() {
+    parse(source);
+}
+
+Expression::~Expression() = default;
+
+bool Expression::parse(const std::string& source) {
+    source_ = source;
+    error_.clear();
+    variables_.clear();
+    compiled_ = false;
+    folded_.reset();
+    program_.clear();
+    
+    size_t pos = 0;
+    parse_depth_ = 0;
+    root_ = parseSum(source, pos);
+    if (root_) {
+        skipSpaces(source, pos);
+        if (pos < source.size()) {
+            error_ = "Unexpected '" + std::string(1, source[pos]) + "' at position " + std::to_string(pos);
+            root_.reset();
+        }
+    }
+    return root_ != nullptr;
+}
+
+std::unique_ptr<Expression::SyntaxNode> Expression::parseSum(const std::string& text, size_t& pos) {
+    auto left = parseProduct(text, pos);
+    while (left) {
+        skipSpaces(text, pos);
+        if (pos >= text.size() || (text[pos] != '+' && text[pos] != '-')) {
+            break;
+        }
+        SyntaxNode::Kind kind = text[pos] == '+' ? SyntaxNode::Kind::ADD : SyntaxNode::Kind::SUBTRACT;
+        ++pos;
+        auto right = parseProduct(text, pos);
+        if (!right) {
+            return nullptr;
+        }
+        left = makeBinary(kind, std::move(left), std::move(right));
+        if (left->depth > MAX_DEPTH) {
+            error_ = nestingError(pos);
+            return nullptr;
+        }
+    }
+    return left;
+}
+
+std::unique_ptr<Expression::SyntaxNode> Expression::parseProduct(const std::string& text, size_t& pos) {
+    auto left = parseUnary(text, pos);
+    while (left) {
+        skipSpaces(text, pos);
+        if (pos >= text.size() || (text[pos] != '*' && text[pos] != '/')) {
+            break;
+        }
+        SyntaxNode::Kind kind = text[pos] == '*' ? SyntaxNode::Kind::MULTIPLY : SyntaxNode::Kind::DIVIDE;
+        ++pos;
+        auto right = parseUnary(text, pos);
+        if (!right) {
+            return nullptr;
+        }
+        left = makeBinary(kind, std::move(left), std::move(right));
+        if (left->depth > MAX_DEPTH) {
+            error_ = nestingError(pos);
+            return nullptr;
+        }
+    }
+    return left;
+}
+
+std::unique_ptr<Expression::SyntaxNode> Expression::parseUnary(const std::string& text, size_t& pos) {
+    // Parentheses and signs recurse through here
+    DepthGuard guard(parse_depth_);
+    if (parse_depth_ > MAX_DEPTH) {
+        error_ = nestingError(pos);
+        return nullptr;
+    }
+    skipSpaces(text, pos);
+    if (pos < text.size() && text[pos] == '+') {
+        ++pos;
+        return parseUnary(text, pos);
+    }
+    if (pos < text.size() && text[pos] == '-') {
+        ++pos;
+        auto operand = parseUnary(text, pos);
+        if (!operand) {
+            return nullptr;
+        }
+        // Negation is 0 - x so it follows the same promotion rules
+        auto zero = std::make_unique<SyntaxNode>();
+        zero->value = ValueData::fromInt(0);
+        auto negation = makeBinary(SyntaxNode::Kind::SUBTRACT, std::move(zero), std::move(operand));
+        if (negation->depth > MAX_DEPTH) {
+            error_ = nestingError(pos);
+            return nullptr;
+        }
+        return negation;
+    }
+    return parsePrimary(text, pos);
+}
+
+std::unique_ptr<Expression::SyntaxNode> Expression::parsePrimary(const std::string& text, size_t& pos) {
+    skipSpaces(text, pos);
+    if (pos >= text.size()) {
+        error_ = "Unexpected end of expression";
+        return nullptr;
+    }
+    
+    char c = text[pos];
+    if (c == '(') {
+        ++pos;
+        auto inner = parseSum(text, pos);
+        if (!inner) {
+            return nullptr;
+        }
+        skipSpaces(text, pos);
+        if (pos >= text.size() || text[pos] != ')') {
+            error_ = "Missing ')' at position " + std::to_string(pos);
+            return nullptr;
+        }
+        ++pos;
+        return inner;
+    }
+    
+    if (c == '"' || c == '\'') {
+        size_t end = text.find(c, pos + 1);
+        if (end == std::string::npos) {
+            error_ = "Unterminated string at position " + std::to_string(pos);
+            return nullptr;
+        }
+        auto node = std::make_unique<SyntaxNode>();
+        node->value = ValueData::fromInternedString(std::string_view(text).substr(pos + 1, end - pos - 1));
+        pos = end + 1;
+        return node;
+    }
+    
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+        size_t start = pos;
+        size_t dots = 0;
+        while (pos < text.size() && (std::isdigit(static_cast<unsigned char>(text[pos])) || text[pos] == '.')) {
+            dots += text[pos] == '.';
+            ++pos;
+        }
+        bool is_integer = dots == 0;
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            size_t exponent = pos + 1;
+            if (exponent < text.size() && (text[exponent] == '+' || text[exponent] == '-')) {
+                ++exponent;
+            }
+            if (exponent < text.size() && std::isdigit(static_cast<unsigned char>(text[exponent]))) {
+                is_integer = false;
+                pos = exponent;
+                while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) {
+                    ++pos;
+                }
+            }
+        }
+        
+        auto node = std::make_unique<SyntaxNode>();
+        const char* first = text.data() + start;
+        const char* last = text.data() + pos;
+        int int_value = 0;
+        if (is_integer && std::from_chars(first, last, int_value).ec == std::errc()) {
+            node->value = ValueData::fromInt(int_value);
+        } else {
+            if (dots > 1 || (last - first == 1 && *first == '.')) {
+                error_ = "Invalid number at position " + std::to_string(start);
+                return nullptr;
+            }
+            // Integer literals that overflow int become doubles
+            node->value = ValueData::fromDouble(ValueData::parseDouble(std::string_view(first, last - first)));
+        }
+        return node;
+    }
+    
+    if (isIdentifierStart(c)) {
+        size_t start = pos;
+        while (pos < text.size() && isIdentifierChar(text[pos])) {
+            ++pos;
+        }
+        auto node = std::make_unique<SyntaxNode>();
+        node->kind = SyntaxNode::Kind::VARIABLE;
+        node->variable = findOrAddVariable(text.substr(start, pos - start));
+        return node;
+    }
+    
+    error_ = "Unexpected '" + std::string(1, c) + "' at position " + std::to_string(pos);
+    return nullptr;
+}
+
+size_t Expression::findOrAddVariable(const std::string& name) {
+    for (size_t i = 0; i < variables_.size(); ++i) {
+        if (variables_[i].name == name) {
+            return i;
+        }
+    }
+    Variable variable;
+    variable.name = name;
+    variables_.push_back(variable);
+    return variables_.size() - 1;
+}
+
+bool Expression::bind(const std::string& name, const Value* value) {
+    return bind(name, value ? &value->getData() : nullptr);
+}
+
+bool Expression::bind(const std::string& name, const ValueData* data) {
+    for (auto& variable : variables_) {
+        if (variable.name == name) {
+            // The type guard in evaluate() picks up a differently typed binding
+            variable.data = data;
+            if (!data) {
+                compiled_ = false;
+            }
+            return true;
+        }
+    }
+    error_ = "Unknown variable '" + name + "'";
+    return false;
+}
+
+bool Expression::bindNodePort(const std::string& name, Node* node, const std::string& port) {
+    if (!node) {
+        error_ = "No node for variable '" + name + "'";
+        return false;
+    }
+    
+    // Outputs take precedence over inputs. Ports are untyped pointers, only
+    // those registered as Value ports can be read.
+    const Value* value = node->getValueOutput(port);
+    if (!value && !node->getOutput(port)) {
+        value = node->getValueInput(port);
+    }
+    if (value) {
+        return bind(name, value);
+    }
+    if (node->getOutput(port) || node->getInput(port)) {
+        error_ = "Port '" + port + "' of node '" + node->getName() + "' does not hold a Value";
+    } else {
+        error_ = "Node '" + node->getName() + "' has no port '" + port + "'";
+    }
+    return false;
+}
+
+std::vector<std::string> Expression::getVariableNames() const {
+    std::vector<std::string> names;
+    names.reserve(variables_.size());
+    for (const auto& variable : variables_) {
+        names.push_back(variable.name);
+    }
+    return names;
+}
+
+bool Expression::isBound() const {
+    for (const auto& variable : variables_) {
+        if (!variable.data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Expression::isConstant() const {
+    return compiled_ && folded_ && folded_->kind == SyntaxNode::Kind::CONSTANT;
+}
+
+bool Expression::compile() {
+    compiled_ = false;
+    program_.clear();
+    int_registers_.clear();
+    double_registers_.clear();
+    generic_registers_.clear();
+    folded_.reset();
+    result_type_ = ValueData::Type::UNDEFINED;
+    
+    if (!root_) {
+        if (error_.empty()) {
+            error_ = "Nothing to compile";
+        }
+        return false;
+    }
+    for (auto& variable : variables_) {
+        if (!variable.data) {
+            error_ = "Unbound variable '" + variable.name + "'";
+            return false;
+        }
+        variable.compiled_type = variable.data->getType();
+    }
+    
+    folded_ = fold(*root_);
+    RegisterClass result_class = classify(*folded_);
+    result_ = emit(*folded_, result_class);
+    if (result_class == RegisterClass::INTEGER) {
+        result_type_ = ValueData::Type::INTEGER;
+    } else if (result_class == RegisterClass::DOUBLE) {
+        result_type_ = ValueData::Type::DOUBLE;
+    } else if (folded_->kind == SyntaxNode::Kind::CONSTANT) {
+        result_type_ = folded_->value.getType();
+    }
+    
+    error_.clear();
+    compiled_ = true;
+    return true;
+}
+
+std::unique_ptr<Expression::SyntaxNode> Expression::fold(const SyntaxNode& node) const {
+    auto copy = std::make_unique<SyntaxNode>();
+    copy->kind = node.kind;
+    copy->value = node.value;
+    copy->variable = node.variable;
+    if (node.kind == SyntaxNode::Kind::CONSTANT || node.kind == SyntaxNode::Kind::VARIABLE) {
+        return copy;
+    }
+    
+    copy->left = fold(*node.left);
+    copy->right = fold(*node.right);
+    if (copy->left->kind == SyntaxNode::Kind::CONSTANT && copy->right->kind == SyntaxNode::Kind::CONSTANT) {
+        copy->value = applyOperator(node.kind, copy->left->value, copy->right->value);
+        copy->kind = SyntaxNode::Kind::CONSTANT;
+        copy->left.reset();
+        copy->right.reset();
+    }
+    return copy;
+}
+
+Expression::RegisterClass Expression::classify(const SyntaxNode& node) const {
+    ValueData::Type type;
+    switch (node.kind) {
+        case SyntaxNode::Kind::CONSTANT:
+            type = node.value.getType();
+            break;
+        case SyntaxNode::Kind::VARIABLE:
+            type = variables_[node.variable].compiled_type;
+            break;
+        default: {
+            RegisterClass left = classify(*node.left);
+            RegisterClass right = classify(*node.right);
+            if (left == RegisterClass::GENERIC || right == RegisterClass::GENERIC) {
+                return RegisterClass::GENERIC;
+            }
+            return left == RegisterClass::INTEGER && right == RegisterClass::INTEGER
+                ? RegisterClass::INTEGER : RegisterClass::DOUBLE;
+        }
+    }
+    if (type == ValueData::Type::INTEGER) {
+        return RegisterClass::INTEGER;
+    } else if (type == ValueData::Type::DOUBLE) {
+        return RegisterClass::DOUBLE;
+    }
+    return RegisterClass::GENERIC;
+}
+
+uint32_t Expression::allocate(RegisterClass register_class) {
+    switch (register_class) {
+        case RegisterClass::INTEGER:
+            int_registers_.push_back(0);
+            return static_cast<uint32_t>(int_registers_.size() - 1);
+        case RegisterClass::DOUBLE:
+            double_registers_.push_back(0.0);
+            return static_cast<uint32_t>(double_registers_.size() - 1);
+        default:
+            generic_registers_.emplace_back();
+            return static_cast<uint32_t>(generic_registers_.size() - 1);
+    }
+}
+
+Expression::Operand Expression::emit(const SyntaxNode& node, RegisterClass target) {
+    RegisterClass natural = classify(node);
+    
+    if (node.kind == SyntaxNode::Kind::CONSTANT) {
+        // Constants are preloaded in the register class they are used in
+        uint32_t index = allocate(target);
+        if (target == RegisterClass::INTEGER) {
+            int_registers_[index] = node.value.asInt();
+        } else if (target == RegisterClass::DOUBLE) {
+            double_registers_[index] = node.value.toDouble();
+        } else {
+            generic_registers_[index] = node.value;
+        }
+        return {target, index};
+    }
+    
+    if (node.kind == SyntaxNode::Kind::VARIABLE) {
+        OpCode op = OpCode::LOAD_GENERIC;
+        if (target == RegisterClass::INTEGER) {
+            op = OpCode::LOAD_INT;
+        } else if (target == RegisterClass::DOUBLE) {
+            op = natural == RegisterClass::INTEGER ? OpCode::LOAD_INT_AS_DOUBLE : OpCode::LOAD_DOUBLE;
+        }
+        uint32_t index = allocate(target);
+        program_.push_back({op, index, static_cast<uint32_t>(node.variable), 0});
+        return {target, index};
+    }
+    
+    Operand left = emit(*node.left, natural);
+    Operand right = emit(*node.right, natural);
+    size_t offset = static_cast<size_t>(node.kind) - static_cast<size_t>(SyntaxNode::Kind::ADD);
+    OpCode base = OpCode::ADD_GENERIC;
+    if (natural == RegisterClass::INTEGER) {
+        base = OpCode::ADD_INT;
+    } else if (natural == RegisterClass::DOUBLE) {
+        base = OpCode::ADD_DOUBLE;
+    }
+    OpCode op = static_cast<OpCode>(static_cast<size_t>(base) + offset);
+    uint32_t index = allocate(natural);
+    program_.push_back({op, index, left.index, right.index});
+    return convert({natural, index}, target);
+}
+
+Expression::Operand Expression::convert(Operand operand, RegisterClass target) {
+    if (operand.register_class == target) {
+        return operand;
+    }
+    
+    OpCode op;
+    if (target == RegisterClass::DOUBLE) {
+        op = OpCode::INT_TO_DOUBLE;
+    } else if (operand.register_class == RegisterClass::INTEGER) {
+        op = OpCode::INT_TO_GENERIC;
+    } else {
+        op = OpCode::DOUBLE_TO_GENERIC;
+    }
+    uint32_t index = allocate(target);
+    program_.push_back({op, index, operand.index, 0});
+    return {target, index};
+}
+
+bool Expression::typesChanged() const {
+    for (const auto& variable : variables_) {
+        if (variable.data->getType() != variable.compiled_type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ValueData Expression::evaluate() {
+    if (!compiled_ || typesChanged()) {
+        if (!compile()) {
+            return ValueData();
+        }
+    }
+    
+    int* ints = int_registers_.data();
+    double* doubles = double_registers_.data();
+    ValueData* generics = generic_registers_.data();
+    const Variable* variables = variables_.data();
+    
+    for (const Instruction& instruction : program_) {
+        const uint32_t t = instruction.target;
+        const uint32_t l = instruction.left;
+        const uint32_t r = instruction.right;
+        switch (instruction.op) {
+            case OpCode::LOAD_INT: ints[t] = variables[l].data->asInt(); break;
+            case OpCode::LOAD_DOUBLE: doubles[t] = variables[l].data->asDouble(); break;
+            case OpCode::LOAD_INT_AS_DOUBLE: doubles[t] = variables[l].data->asInt(); break;
+            case OpCode::LOAD_GENERIC: generics[t] = *variables[l].data; break;
+            case OpCode::INT_TO_DOUBLE: doubles[t] = ints[l]; break;
+            case OpCode::INT_TO_GENERIC: generics[t] = ValueData::fromInt(ints[l]); break;
+            case OpCode::DOUBLE_TO_GENERIC: generics[t] = ValueData::fromDouble(doubles[l]); break;
+            case OpCode::ADD_INT: ints[t] = ValueData::addInts(ints[l], ints[r]); break;
+            case OpCode::SUBTRACT_INT: ints[t] = ValueData::subtractInts(ints[l], ints[r]); break;
+            case OpCode::MULTIPLY_INT: ints[t] = ValueData::multiplyInts(ints[l], ints[r]); break;
+            case OpCode::DIVIDE_INT:
+                if (ints[r] == 0) {
+                    // Division by zero is UNDEFINED, which the typed registers can't hold
+                    return evaluateTree(*folded_);
+                }
+                ints[t] = ValueData::divideInts(ints[l], ints[r]);
+                break;
+            case OpCode::ADD_DOUBLE: doubles[t] = doubles[l] + doubles[r]; break;
+            case OpCode::SUBTRACT_DOUBLE: doubles[t] = doubles[l] - doubles[r]; break;
+            case OpCode::MULTIPLY_DOUBLE: doubles[t] = doubles[l] * doubles[r]; break;
+            case OpCode::DIVIDE_DOUBLE:
+                if (doubles[r] == 0.0) {
+                    return evaluateTree(*folded_);
+                }
+                doubles[t] = doubles[l] / doubles[r];
+                break;
+            case OpCode::ADD_GENERIC: generics[t] = ValueData::add(generics[l], generics[r]); break;
+            case OpCode::SUBTRACT_GENERIC: generics[t] = ValueData::subtract(generics[l], generics[r]); break;
+            case OpCode::MULTIPLY_GENERIC: generics[t] = ValueData::multiply(generics[l], generics[r]); break;
+            case OpCode::DIVIDE_GENERIC: generics[t] = ValueData::divide(generics[l], generics[r]); break;
+        }
+    }
+    return readResult();
+}
+
+ValueData Expression::readResult() const {
+    switch (result_.register_class) {
+        case RegisterClass::INTEGER: return ValueData::fromInt(int_registers_[result_.index]);
+        case RegisterClass::DOUBLE: return ValueData::fromDouble(double_registers_[result_.index]);
+        default: return generic_registers_[result_.index];
+    }
+}
+
+ValueData Expression::evaluateTree(const SyntaxNode& node) const {
+    switch (node.kind) {
+        case SyntaxNode::Kind::CONSTANT:
+            return node.value;
+        case SyntaxNode::Kind::VARIABLE:
+            return *variables_[node.variable].data;
+        default:
+            return applyOperator(node.kind, evaluateTree(*node.left), evaluateTree(*node.right));
+    }
+}
@@ -0,0 +1,364 @@
+#include "../include/HistoryJournal.h"
+#include "../include/ConstructionHistory.h"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+const char HistoryJournal::MAGIC[4] = {'D', 'S', 'C', 'J'};
+
+namespace {
+
+uint32_t recordChecksum(uint8_t type, const char* payload, size_t size) {
+    // FNV-1a over type and payload, enough to detect torn tail writes
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ type) * 16777619u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(payload[i])) * 16777619u;
+    }
+    return hash;
+}
+
+void putU32(std::vector<char>& out, uint32_t value) {
+    char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+void setU32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint32_t getU32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+// Reads a length-prefixed string, false if it runs past the end
+bool getString(const char*& data, const char* end, std::string& out) {
+    if (end - data < 4) {
+        return false;
+    }
+    uint32_t size = getU32(data);
+    data += 4;
+    if (static_cast<size_t>(end - data) < size) {
+        return false;
+    }
+    out.assign(data, size);
+    data += size;
+    return true;
+}
+
+} // namespace
+
+HistoryJournal::HistoryJournal(const std::string& path)
+    : path_(path), fd_(-1), appended_seq_(0), durable_seq_(0), sync_count_(0),
+      checkpoint_requested_(false), flush_requested_(false), stopping_(false),
+      commit_interval_(std::chrono::milliseconds(5)), commit_batch_bytes_(64 * 1024) {
+}
+
+HistoryJournal::~HistoryJournal() {
+    close();
+}
+
+bool HistoryJournal::open() {
+    if (isOpen()) {
+        return true;
+    }
+    
+    int fd = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    fd_ = fd;
+    
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        fd_ = -1;
+        ::close(fd);
+        return false;
+    }
+    
+    if (info.st_size == 0) {
+        std::vector<char> header(MAGIC, MAGIC + 4);
+        putU32(header, VERSION);
+        if (!writeAll(header.data(), header.size()) || ::fsync(fd) != 0) {
+            fd_ = -1;
+            ::close(fd);
+            return false;
+        }
+    }
+    
+    stopping_ = false;
+    writer_ = std::thread(&HistoryJournal::writerLoop, this);
+    return true;
+}
+
+void HistoryJournal::close() {
+    if (!isOpen()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    
+    ::close(fd_.exchange(-1));
+}
+
+void HistoryJournal::append(RecordType type, const std::string& stream, const std::string& text,
+                            const std::string& data) {
+    if (!isOpen()) {
+        return;
+    }
+    
+    uint8_t type_byte = static_cast<uint8_t>(type);
+    bool wake_writer = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        size_t start = pending_.size();
+        pending_.resize(start + RECORD_HEADER_SIZE);
+        putU32(pending_, static_cast<uint32_t>(stream.size()));
+        pending_.insert(pending_.end(), stream.begin(), stream.end());
+        putU32(pending_, static_cast<uint32_t>(text.size()));
+        pending_.insert(pending_.end(), text.begin(), text.end());
+        pending_.insert(pending_.end(), data.begin(), data.end());
+        
+        // Fill in the header once the payload is in place
+        const char* payload = pending_.data() + start + RECORD_HEADER_SIZE;
+        size_t size = pending_.size() - start - RECORD_HEADER_SIZE;
+        setU32(pending_.data() + start, static_cast<uint32_t>(size));
+        setU32(pending_.data() + start + 4, recordChecksum(type_byte, payload, size));
+        pending_[start + 8] = static_cast<char>(type_byte);
+        ++appended_seq_;
+        wake_writer = pending_.size() >= commit_batch_bytes_;
+    }
+    if (wake_writer) {
+        queue_cv_.notify_one();
+    }
+}
+
+void HistoryJournal::flush() {
+    if (!isOpen()) {
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    uint64_t target = appended_seq_;
+    flush_requested_ = true;
+    queue_cv_.notify_one();
+    durable_cv_.wait(lock, [this, target] { return durable_seq_ >= target || stopping_; });
+}
+
+bool HistoryJournal::checkpoint() {
+    if (!isOpen()) {
+        return false;
+    }
+    
+    // Records still queued describe state that is now part of the saved document
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        pending_.clear();
+        checkpoint_requested_ = true;
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+size_t HistoryJournal::replay(const std::string& path, const std::string& stream, ConstructionHistory& history) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+    
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, 4) != 0 ||
+        getU32(data.data() + 4) != VERSION) {
+        return 0;
+    }
+    
+    // Streams get an id when first seen and keep it across renames, so the
+    // records written under an earlier name still belong to the stream
+    struct Record {
+        RecordType type;
+        size_t stream_id;
+        std::string text;
+        std::string data;
+    };
+    std::vector<Record> records;
+    std::unordered_map<std::string, size_t> stream_ids;
+    size_t next_stream_id = 0;
+    
+    size_t offset = HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= data.size()) {
+        uint32_t size = getU32(data.data() + offset);
+        uint32_t checksum = getU32(data.data() + offset + 4);
+        uint8_t type = static_cast<uint8_t>(data[offset + 8]);
+        const char* payload = data.data() + offset + RECORD_HEADER_SIZE;
+        if (size > data.size() - offset - RECORD_HEADER_SIZE ||
+            recordChecksum(type, payload, size) != checksum) {
+            break; // Torn tail from a crash mid-write
+        }
+        offset += RECORD_HEADER_SIZE + size;
+        
+        const char* end = payload + size;
+        std::string name;
+        Record record;
+        record.type = static_cast<RecordType>(type);
+        if (!getString(payload, end, name) || !getString(payload, end, record.text)) {
+            break;
+        }
+        record.data.assign(payload, end);
+        
+        auto id = stream_ids.emplace(name, next_stream_id);
+        if (id.second) {
+            ++next_stream_id;
+        }
+        record.stream_id = id.first->second;
+        if (record.type == RecordType::RENAME_STREAM) {
+            stream_ids.erase(name);
+            stream_ids[record.text] = record.stream_id;
+            continue;
+        }
+        records.push_back(std::move(record));
+    }
+    
+    auto target = stream_ids.find(stream);
+    if (target == stream_ids.end()) {
+        return 0;
+    }
+    
+    // Replayed operations must not be journaled a second time
+    std::shared_ptr<HistoryJournal> attached = history.getJournal();
+    std::string attached_stream = history.getJournalStream();
+    history.setJournal(nullptr);
+    
+    size_t applied = 0;
+    for (const Record& record : records) {
+        if (record.stream_id != target->second) {
+            continue;
+        }
+        switch (record.type) {
+            case RecordType::ADD_STEP:
+                history.recoverStep(record.text, record.data);
+                break;
+            case RecordType::UNDO:
+                history.undo();
+                break;
+            case RecordType::REDO:
+                history.redo();
+                break;
+            case RecordType::CREATE_BRANCH:
+                history.createBranch(record.text);
+                break;
+            case RecordType::SWITCH_BRANCH:
+                history.switchToBranch(record.text);
+                break;
+            case RecordType::REMOVE_BRANCH:
+                history.removeBranch(record.text);
+                break;
+            case RecordType::CLEAR:
+                history.clear();
+                break;
+            case RecordType::RENAME_STREAM:
+                break;
+        }
+        ++applied;
+    }
+    
+    history.setJournal(attached, attached_stream);
+    return applied;
+}
+
+uint64_t HistoryJournal::getAppendedCount() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return appended_seq_;
+}
+
+uint64_t HistoryJournal::getDurableCount() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return durable_seq_;
+}
+
+uint64_t HistoryJournal::getSyncCount() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return sync_count_;
+}
+
+void HistoryJournal::writerLoop() {
+    std::vector<char> batch;
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    
+    while (true) {
+        queue_cv_.wait(lock, [this] {
+            return stopping_ || flush_requested_ || checkpoint_requested_ || !pending_.empty();
+        });
+        
+        // Let more records join the batch unless someone is waiting on it
+        if (!stopping_ && !flush_requested_ && !checkpoint_requested_) {
+            queue_cv_.wait_for(lock, commit_interval_, [this] {
+                return stopping_ || flush_requested_ || pending_.size() >= commit_batch_bytes_;
+            });
+        }
+        
+        // Batches written before a checkpoint request are cut off by the
+        // truncation, records in this batch were appended after it
+        batch.clear();
+        batch.swap(pending_);
+        uint64_t batch_seq = appended_seq_;
+        bool truncate = checkpoint_requested_;
+        bool stop = stopping_;
+        checkpoint_requested_ = false;
+        flush_requested_ = false;
+        lock.unlock();
+        
+        bool written = true;
+        if (truncate) {
+            written = ::ftruncate(fd_, HEADER_SIZE) == 0;
+        }
+        if (!batch.empty()) {
+            written = writeAll(batch.data(), batch.size()) && written;
+        }
+        bool synced = (truncate || !batch.empty()) && written && ::fsync(fd_) == 0;
+        
+        lock.lock();
+        if (synced) {
+            ++sync_count_;
+        }
+        if (batch_seq > durable_seq_) {
+            durable_seq_ = batch_seq;
+        }
+        durable_cv_.notify_all();
+        
+        if (stop && pending_.empty()) {
+            break;
+        }
+    }
+}
+
+bool HistoryJournal::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd_, data, size);
+        if (written < 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
@@ -0,0 +1,187 @@
+#include "../include/HitTester.h"
+#include "../include/CullingStage.h"
+#include <algorithm>
+#include <cstring>
+
+HitTester::HitTester(int width, int height)
+    : renderer_(width, height), valid_(false), pass_count_(0), rect_cached_(false) {
+    renderer_.initialize();
+    renderer_.enableIdBuffer(true);
+    scene_.viewport_width = width;
+    scene_.viewport_height = height;
+}
+
+void HitTester::setScene(const SceneSnapshot& scene) {
+    int width = scene_.viewport_width;
+    int height = scene_.viewport_height;
+    scene_ = scene;
+    scene_.viewport_width = width;
+    scene_.viewport_height = height;
+    valid_ = false;
+}
+
+void HitTester::setCamera(const float* projection, const float* model_view, int width, int height) {
+    if (std::memcmp(projection, scene_.projection, sizeof(scene_.projection)) == 0 &&
+        std::memcmp(model_view, scene_.model_view, sizeof(scene_.model_view)) == 0 &&
+        width == scene_.viewport_width && height == scene_.viewport_height) {
+        return;
+    }
+    scene_.setProjectionMatrix(projection);
+    scene_.setModelViewMatrix(model_view);
+    scene_.viewport_width = width;
+    scene_.viewport_height = height;
+    valid_ = false;
+}
+
+void HitTester::setPointPickSize(float pixels) {
+    if (pixels != renderer_.getPointSize()) {
+        renderer_.setPointSize(pixels);
+        valid_ = false;
+    }
+}
+
+void HitTester::ensureIdPass() {
+    if (!valid_) {
+        renderIdPass();
+    }
+}
+
+void HitTester::renderIdPass() {
+    if (renderer_.getViewportWidth() != scene_.viewport_width ||
+        renderer_.getViewportHeight() != scene_.viewport_height) {
+        renderer_.setViewport(scene_.viewport_width, scene_.viewport_height);
+    }
+    renderer_.clear();
+    renderer_.setProjectionMatrix(scene_.projection);
+    renderer_.setModelViewMatrix(scene_.model_view);
+    ranges_.clear();
+    
+    // Id 0 is the background, ranges start at 1
+    uint32_t next_id = 1;
+    for (size_t i = 0; i < scene_.batches.size(); ++i) {
+        const SceneBatch& batch = scene_.batches[i];
+        size_t per_primitive = batch.primitive == PrimitiveType::TRIANGLES ? 3 :
+                               batch.primitive == PrimitiveType::LINES ? 2 : 1;
+        ranges_.push_back(IdRange{next_id, PickKind::BATCH, static_cast<uint32_t>(i)});
+        renderer_.setDrawId(next_id, true);
+        renderer_.enableDepthTest(batch.depth_test);
+        switch (batch.primitive) {
+            case PrimitiveType::TRIANGLES: renderer_.drawTriangles(batch.vertices); break;
+            case PrimitiveType::LINES: renderer_.drawLines(batch.vertices); break;
+            case PrimitiveType::POINTS: renderer_.drawPoints(batch.vertices); break;
+        }
+        next_id += static_cast<uint32_t>(batch.vertices.size() / per_primitive);
+    }
+    
+    // Points keep their live index in the id; chunks outside the view are skipped
+    Frustum frustum = Frustum::fromMatrices(scene_.projection, scene_.model_view);
+    renderer_.enableDepthTest(true);
+    for (size_t i = 0; i < scene_.point_layers.size(); ++i) {
+        const PointStore& points = scene_.point_layers[i].points;
+        ranges_.push_back(IdRange{next_id, PickKind::POINTS, static_cast<uint32_t>(i)});
+        double min_x, min_y, max_x, max_y;
+        points.getBounds(min_x, min_y, max_x, max_y);
+        
+        // Consecutive visible chunks have consecutive ids and share one draw
+        uint32_t run_first = next_id;
+        uint32_t chunk_first = next_id;
+        vertices_.clear();
+        for (size_t c = 0; c < points.getChunkCount(); ++c) {
+            const PointChunk& chunk = points.getChunk(c);
+            bool visible = chunk.live > 0 &&
+                frustum.intersectsBox(static_cast<float>(chunk.min_x), static_cast<float>(chunk.min_y), 0.0f,
+                                      static_cast<float>(chunk.max_x), static_cast<float>(chunk.max_y), 0.0f);
+            if (!visible) {
+                if (!vertices_.empty()) {
+                    renderer_.setDrawId(run_first, true);
+                    renderer_.drawPoints(vertices_);
+                    vertices_.clear();
+                }
+                chunk_first += chunk.live;
+                run_first = chunk_first;
+                continue;
+            }
+            for (size_t k = 0; k < chunk.points.size(); ++k) {
+                if (!chunk.isDead(k)) {
+                    vertices_.push_back(Vertex3D{static_cast<float>(chunk.points[k].getX()),
+                                                 static_cast<float>(chunk.points[k].getY()), 0.0f,
+                                                 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f});
+                }
+            }
+            chunk_first += chunk.live;
+        }
+        if (!vertices_.empty()) {
+            renderer_.setDrawId(run_first, true);
+            renderer_.drawPoints(vertices_);
+        }
+        next_id += static_cast<uint32_t>(points.size());
+    }
+    
+    renderer_.setDrawId(0, false);
+    renderer_.flush();
+    rect_cached_ = false;
+    valid_ = true;
+    pass_count_++;
+}
+
+PickHit HitTester::decode(uint32_t id) const {
+    auto it = std::upper_bound(ranges_.begin(), ranges_.end(), id, [](uint32_t value, const IdRange& range) {
+        return value < range.first;
+    });
+    const IdRange& range = *(it - 1);
+    return PickHit{range.kind, range.layer, id - range.first};
+}
+
+std::optional<PickHit> HitTester::pick(int x, int y, int radius) {
+    ensureIdPass();
+    radius = std::max(radius, 0);
+    int x0 = std::max(x - radius, 0);
+    int y0 = std::max(y - radius, 0);
+    int x1 = std::min(x + radius + 1, scene_.viewport_width);
+    int y1 = std::min(y + radius + 1, scene_.viewport_height);
+    if (x0 >= x1 || y0 >= y1 || !renderer_.readIdBuffer(x0, y0, x1 - x0, y1 - y0, ids_)) {
+        return std::nullopt;
+    }
+    
+    uint32_t best = 0;
+    int best_distance = 0;
+    int width = x1 - x0;
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        if (ids_[i] == 0) {
+            continue;
+        }
+        int dx = x0 + static_cast<int>(i % width) - x;
+        int dy = y0 + static_cast<int>(i / width) - y;
+        int distance = dx * dx + dy * dy;
+        if (best == 0 || distance < best_distance) {
+            best = ids_[i];
+            best_distance = distance;
+        }
+    }
+    if (best == 0) {
+        return std::nullopt;
+    }
+    return decode(best);
+}
+
+const std::vector<PickHit>& HitTester::pickRect(int x0, int y0, int x1, int y1) {
+    ensureIdPass();
+    int rect[4] = {std::min(x0, x1), std::min(y0, y1), std::max(x0, x1), std::max(y0, y1)};
+    if (rect_cached_ && std::equal(rect, rect + 4, cached_rect_)) {
+        return cached_hits_;
+    }
+    
+    cached_hits_.clear();
+    if (renderer_.readIdBuffer(rect[0], rect[1], rect[2] - rect[0] + 1, rect[3] - rect[1] + 1, ids_)) {
+        std::sort(ids_.begin(), ids_.end());
+        ids_.erase(std::unique(ids_.begin(), ids_.end()), ids_.end());
+        for (uint32_t id : ids_) {
+            if (id != 0) {
+                cached_hits_.push_back(decode(id));
+            }
+        }
+    }
+    std::copy(rect, rect + 4, cached_rect_);
+    rect_cached_ = true;
+    return cached_hits_;
+}
@@ -6,10 +6,22 @@ Node::Node(const std::string& name, const std::string& type)
 
 void Node::addInput(const std::string& name, void* data) {
     inputs_[name] = data;
+    value_inputs_.erase(name);
 }
 
 void Node::addOutput(const std::string& name, void* data) {
     outputs_[name] = data;
+    value_outputs_.erase(name);
+}
+
+void Node::addValueInput(const std::string& name, Value* value) {
+    inputs_[name] = value;
+    value_inputs_.insert(name);
+}
+
+void Node::addValueOutput(const std::string& name, Value* value) {
+    outputs_[name] = value;
+    value_outputs_.insert(name);
 }
 
 void* Node::getInput(const std::string& name) const {
@@ -28,11 +40,23 @@ void* Node::getOutput(const std::string& name) const {
     return nullptr;
 }
 
+Value* Node::getValueInput(const std::string& name) const {
+    return value_inputs_.count(name) ? static_cast<Value*>(getInput(name)) : nullptr;
+}
+
+Value* Node::getValueOutput(const std::string& name) const {
+    return value_outputs_.count(name) ? static_cast<Value*>(getOutput(name)) : nullptr;
+}
+
 void Node::connectTo(Node* target_node, const std::string& output_name, const std::string& input_name) {
     if (target_node) {
         void* output_data = getOutput(output_name);
         if (output_data) {
-            target_node->addInput(input_name, output_data);
+            if (value_outputs_.count(output_name)) {
+                target_node->addValueInput(input_name, static_cast<Value*>(output_data));
+            } else {
+                target_node->addInput(input_name, output_data);
+            }
             connected_nodes_.push_back(target_node);
         }
     }
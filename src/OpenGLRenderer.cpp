@@ -1,6 +1,12 @@
 #include "../include/OpenGLRenderer.h"
+#include <algorithm>
 
-OpenGLRenderer::OpenGLRenderer() : initialized_(false), viewport_width_(800), viewport_height_(600) {
+OpenGLRenderer::OpenGLRenderer()
+    : initialized_(false), headless_(false), viewport_width_(800), viewport_height_(600),
+      depth_test_(false), lighting_(false), next_buffer_(1) {
+    for (int i = 0; i < 16; ++i) {
+        projection_[i] = model_view_[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
 }
 
 OpenGLRenderer::~OpenGLRenderer() {
@@ -12,21 +18,28 @@ bool OpenGLRenderer::initialize() {
         return true;
     }
     
-    setupOpenGL21();
+    if (!headless_) {
+        setupOpenGL21();
+    }
     initialized_ = true;
     return true;
 }
 
 void OpenGLRenderer::shutdown() {
+    while (!buffers_.empty()) {
+        destroyBuffer(buffers_.begin()->first);
+    }
     initialized_ = false;
 }
 
 void OpenGLRenderer::beginRender() {
     // OpenGL rendering begin
+    render_stats_.beginFrame();
 }
 
 void OpenGLRenderer::endRender() {
     // OpenGL rendering end
+    render_stats_.endFrame();
 }
 
 void OpenGLRenderer::setViewport(int width, int height) {
@@ -41,33 +54,323 @@ void OpenGLRenderer::clear(float r, float g, float b, float a) {
 }
 
 void OpenGLRenderer::drawTriangles(const std::vector<Vertex3D>& vertices) {
-    // OpenGL triangle drawing implementation
+    drawImmediate(PrimitiveType::TRIANGLES, vertices);
 }
 
 void OpenGLRenderer::drawLines(const std::vector<Vertex3D>& vertices) {
-    // OpenGL line drawing implementation
+    drawImmediate(PrimitiveType::LINES, vertices);
 }
 
 void OpenGLRenderer::drawPoints(const std::vector<Vertex3D>& vertices) {
-    // OpenGL point drawing implementation
+    drawImmediate(PrimitiveType::POINTS, vertices);
+}
+
+void OpenGLRenderer::drawImmediate(PrimitiveType primitive, const std::vector<Vertex3D>& vertices) {
+    // Pack the batch into its smallest layout before it goes over the bus
+    RenderStageTimer timer(render_stats_, RenderStage::GEOMETRY);
+    uint32_t uniform_color;
+    VertexLayout layout = chooseVertexLayout(vertices.data(), vertices.size(), uniform_color);
+    size_t bytes = vertices.size() * getVertexStride(layout);
+    immediate_data_.resize(bytes);
+    encodeVertices(layout, vertices.data(), vertices.size(), immediate_data_.data());
+    upload_stats_.immediate_bytes += bytes;
+    render_stats_.addUploadedBytes(bytes);
+    
+    if (!headless_) {
+        // glBindBuffer(GL_ARRAY_BUFFER, 0);
+        setVertexPointers(layout, uniform_color, immediate_data_.data());
+        // glDrawArrays(mode, 0, vertices.size());
+    }
+    drawArrays(primitive, vertices.size());
+}
+
+void OpenGLRenderer::setVertexPointers(VertexLayout layout, [[maybe_unused]] uint32_t uniform_color,
+                                       [[maybe_unused]] const uint8_t* base) {
+    // int stride = static_cast<int>(getVertexStride(layout));
+    // glVertexPointer(3, GL_FLOAT, stride, base);
+    switch (layout) {
+        case VertexLayout::POSITION:
+            // glDisableClientState(GL_COLOR_ARRAY);
+            // glDisableVertexAttribArray(NORMAL_ATTRIBUTE);
+            // glColor4ubv(reinterpret_cast<const GLubyte*>(&uniform_color));
+            break;
+        case VertexLayout::POSITION_COLOR:
+            // glEnableClientState(GL_COLOR_ARRAY);
+            // glDisableVertexAttribArray(NORMAL_ATTRIBUTE);
+            // glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(VertexPC, rgba));
+            break;
+        case VertexLayout::POSITION_NORMAL_COLOR:
+            // The lighting shader decodes the octahedral normal
+            // glEnableClientState(GL_COLOR_ARRAY);
+            // glColorPointer(4, GL_UNSIGNED_BYTE, stride, base + offsetof(VertexPNC, rgba));
+            // glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
+            // glVertexAttribPointer(NORMAL_ATTRIBUTE, 2, GL_SHORT, GL_TRUE, stride, base + offsetof(VertexPNC, normal));
+            break;
+    }
+}
+
+BufferHandle OpenGLRenderer::createBuffer(const std::vector<Vertex3D>& vertices, BufferUsage usage) {
+    BufferHandle handle = next_buffer_++;
+    RetainedBuffer& buffer = buffers_[handle];
+    buffer.usage = usage;
+    storeVertices(buffer, 0, vertices.data(), vertices.size());
+    if (!headless_) {
+        // glGenBuffers(1, &buffer.gl_buffer);
+    }
+    // First draw allocates and uploads everything
+    markDirty(buffer, 0, buffer.vertex_count);
+    return handle;
+}
+
+bool OpenGLRenderer::updateBuffer(BufferHandle handle, size_t first_vertex, const Vertex3D* vertices, size_t count) {
+    auto it = buffers_.find(handle);
+    if (it == buffers_.end() || first_vertex > it->second.vertex_count) {
+        return false;
+    }
+    
+    // Writing past the end grows the buffer
+    RetainedBuffer& buffer = it->second;
+    storeVertices(buffer, first_vertex, vertices, count);
+    markDirty(buffer, first_vertex, first_vertex + count);
+    return true;
+}
+
+bool OpenGLRenderer::setBufferData(BufferHandle handle, const std::vector<Vertex3D>& vertices) {
+    auto it = buffers_.find(handle);
+    if (it == buffers_.end()) {
+        return false;
+    }
+    
+    // New contents pick their layout from scratch
+    RetainedBuffer& buffer = it->second;
+    buffer.data.clear();
+    buffer.vertex_count = 0;
+    buffer.dirty.clear();
+    storeVertices(buffer, 0, vertices.data(), vertices.size());
+    markDirty(buffer, 0, buffer.vertex_count);
+    return true;
+}
+
+void OpenGLRenderer::storeVertices(RetainedBuffer& buffer, size_t first_vertex, const Vertex3D* vertices, size_t count) {
+    uint32_t uniform_color;
+    VertexLayout needed = chooseVertexLayout(vertices, count, uniform_color);
+    if (buffer.vertex_count == 0) {
+        buffer.layout = needed;
+        buffer.uniform_color = uniform_color;
+    } else if (count > 0) {
+        if (needed == VertexLayout::POSITION && uniform_color != buffer.uniform_color) {
+            needed = VertexLayout::POSITION_COLOR;
+        }
+        if (needed > buffer.layout) {
+            convertBuffer(buffer, needed);
+        }
+    }
+    
+    size_t stride = getVertexStride(buffer.layout);
+    if (first_vertex + count > buffer.vertex_count) {
+        buffer.vertex_count = first_vertex + count;
+        buffer.data.resize(buffer.vertex_count * stride);
+    }
+    encodeVertices(buffer.layout, vertices, count, buffer.data.data() + first_vertex * stride);
+}
+
+void OpenGLRenderer::convertBuffer(RetainedBuffer& buffer, VertexLayout layout) {
+    // Layouts only grow, so no information is lost beyond the packing itself
+    size_t old_stride = getVertexStride(buffer.layout);
+    size_t new_stride = getVertexStride(layout);
+    std::vector<uint8_t> data(buffer.vertex_count * new_stride);
+    for (size_t i = 0; i < buffer.vertex_count; ++i) {
+        Vertex3D vertex = decodeVertex(buffer.layout, buffer.data.data() + i * old_stride, buffer.uniform_color);
+        encodeVertices(layout, &vertex, 1, data.data() + i * new_stride);
+    }
+    buffer.data.swap(data);
+    buffer.layout = layout;
+    
+    // Stride changed: the GPU copy is reallocated on the next draw
+    buffer.dirty.clear();
+    markDirty(buffer, 0, buffer.vertex_count);
+}
+
+void OpenGLRenderer::destroyBuffer(BufferHandle handle) {
+    auto it = buffers_.find(handle);
+    if (it == buffers_.end()) {
+        return;
+    }
+    if (!headless_ && it->second.gl_buffer != 0) {
+        // glDeleteBuffers(1, &it->second.gl_buffer);
+    }
+    buffers_.erase(it);
+}
+
+size_t OpenGLRenderer::getBufferVertexCount(BufferHandle handle) const {
+    auto it = buffers_.find(handle);
+    return it != buffers_.end() ? it->second.vertex_count : 0;
+}
+
+VertexLayout OpenGLRenderer::getBufferLayout(BufferHandle handle) const {
+    auto it = buffers_.find(handle);
+    return it != buffers_.end() ? it->second.layout : VertexLayout::POSITION;
+}
+
+size_t OpenGLRenderer::getBufferByteSize(BufferHandle handle) const {
+    auto it = buffers_.find(handle);
+    return it != buffers_.end() ? it->second.data.size() : 0;
+}
+
+void OpenGLRenderer::drawBuffer(BufferHandle handle, PrimitiveType primitive, size_t first_vertex, size_t count) {
+    auto it = buffers_.find(handle);
+    if (it == buffers_.end()) {
+        return;
+    }
+    RetainedBuffer& buffer = it->second;
+    uploadDirtyRanges(buffer);
+    
+    if (first_vertex >= buffer.vertex_count) {
+        return;
+    }
+    size_t available = buffer.vertex_count - first_vertex;
+    count = count == 0 ? available : std::min(count, available);
+    if (!headless_) {
+        // glBindBuffer(GL_ARRAY_BUFFER, buffer.gl_buffer);
+        setVertexPointers(buffer.layout, buffer.uniform_color, nullptr);
+        // glDrawArrays(mode, first_vertex, count);
+    }
+    drawArrays(primitive, count);
+}
+
+bool OpenGLRenderer::readBuffer(BufferHandle handle, size_t first_vertex, size_t count, std::vector<Vertex3D>& vertices) const {
+    auto it = buffers_.find(handle);
+    if (it == buffers_.end()) {
+        return false;
+    }
+    const RetainedBuffer& buffer = it->second;
+    vertices.clear();
+    if (first_vertex >= buffer.vertex_count) {
+        return true;
+    }
+    size_t available = buffer.vertex_count - first_vertex;
+    count = count == 0 ? available : std::min(count, available);
+    size_t stride = getVertexStride(buffer.layout);
+    vertices.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        vertices[i] = decodeVertex(buffer.layout, buffer.data.data() + (first_vertex + i) * stride, buffer.uniform_color);
+    }
+    return true;
+}
+
+void OpenGLRenderer::markDirty(RetainedBuffer& buffer, size_t begin, size_t end) {
+    if (begin >= end) {
+        return;
+    }
+    
+    // Insert and merge overlapping or touching ranges
+    DirtyRange range{begin, end};
+    std::vector<DirtyRange> merged;
+    merged.reserve(buffer.dirty.size() + 1);
+    bool inserted = false;
+    for (const DirtyRange& existing : buffer.dirty) {
+        if (existing.end < range.begin) {
+            merged.push_back(existing);
+        } else if (range.end < existing.begin) {
+            if (!inserted) {
+                merged.push_back(range);
+                inserted = true;
+            }
+            merged.push_back(existing);
+        } else {
+            range.begin = std::min(range.begin, existing.begin);
+            range.end = std::max(range.end, existing.end);
+        }
+    }
+    if (!inserted) {
+        merged.push_back(range);
+    }
+    
+    // Too many small edits: close the smallest gaps instead of issuing many uploads
+    while (merged.size() > MAX_DIRTY_RANGES) {
+        size_t best = 0;
+        for (size_t i = 1; i + 1 < merged.size(); ++i) {
+            if (merged[i + 1].begin - merged[i].end < merged[best + 1].begin - merged[best].end) {
+                best = i;
+            }
+        }
+        merged[best].end = merged[best + 1].end;
+        merged.erase(merged.begin() + best + 1);
+    }
+    buffer.dirty.swap(merged);
+}
+
+void OpenGLRenderer::uploadDirtyRanges(RetainedBuffer& buffer) {
+    if (buffer.dirty.empty()) {
+        return;
+    }
+    
+    size_t stride = getVertexStride(buffer.layout);
+    if (buffer.vertex_count > buffer.gpu_vertex_count || buffer.layout != buffer.gpu_layout) {
+        // Reallocate, which needs the whole buffer
+        size_t bytes = buffer.data.size();
+        if (!headless_) {
+            // glBindBuffer(GL_ARRAY_BUFFER, buffer.gl_buffer);
+            // glBufferData(GL_ARRAY_BUFFER, bytes, buffer.data.data(),
+            //              buffer.usage == BufferUsage::STATIC ? GL_STATIC_DRAW :
+            //              buffer.usage == BufferUsage::DYNAMIC ? GL_DYNAMIC_DRAW : GL_STREAM_DRAW);
+        }
+        buffer.gpu_vertex_count = buffer.vertex_count;
+        buffer.gpu_layout = buffer.layout;
+        upload_stats_.buffer_uploads++;
+        upload_stats_.bytes_uploaded += bytes;
+        render_stats_.addUploadedBytes(bytes);
+    } else {
+        for (const DirtyRange& range : buffer.dirty) {
+            size_t end = std::min(range.end, buffer.vertex_count);
+            if (range.begin >= end) {
+                continue;
+            }
+            size_t bytes = (end - range.begin) * stride;
+            if (!headless_) {
+                // glBindBuffer(GL_ARRAY_BUFFER, buffer.gl_buffer);
+                // glBufferSubData(GL_ARRAY_BUFFER, range.begin * stride, bytes,
+                //                 buffer.data.data() + range.begin * stride);
+            }
+            upload_stats_.buffer_uploads++;
+            upload_stats_.bytes_uploaded += bytes;
+            render_stats_.addUploadedBytes(bytes);
+        }
+    }
+    buffer.dirty.clear();
+}
+
+void OpenGLRenderer::drawArrays(PrimitiveType primitive, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    upload_stats_.draw_calls++;
+    upload_stats_.vertices_drawn += count;
+    size_t primitives = primitive == PrimitiveType::TRIANGLES ? count / 3 :
+                        primitive == PrimitiveType::LINES ? count / 2 : count;
+    render_stats_.addDraw(primitives, count);
 }
 
 void OpenGLRenderer::setProjectionMatrix(const float* matrix) {
+    std::copy(matrix, matrix + 16, projection_);
     // glMatrixMode(GL_PROJECTION);
     // glLoadMatrixf(matrix);
 }
 
 void OpenGLRenderer::setModelViewMatrix(const float* matrix) {
+    std::copy(matrix, matrix + 16, model_view_);
     // glMatrixMode(GL_MODELVIEW);
     // glLoadMatrixf(matrix);
 }
 
 void OpenGLRenderer::enableDepthTest(bool enable) {
+    depth_test_ = enable;
     // if (enable) glEnable(GL_DEPTH_TEST);
     // else glDisable(GL_DEPTH_TEST);
 }
 
 void OpenGLRenderer::enableLighting(bool enable) {
+    lighting_ = enable;
     // if (enable) glEnable(GL_LIGHTING);
     // else glDisable(GL_LIGHTING);
 }
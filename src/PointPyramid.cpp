@@ -0,0 +1,351 @@
+#include "../include/PointPyramid.h"
+#include "../include/CullingStage.h"
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+PointPyramid::PointPyramid()
+    : vertex_budget_(DEFAULT_VERTEX_BUDGET), max_screen_error_(1.0f),
+      color_{0, 0, 0, 1.0f, 1.0f, 1.0f, 1.0f, 0, 0, 0}, selected_root_(nullptr) {
+}
+
+void PointPyramid::setPointColor(float r, float g, float b, float a) {
+    if (color_.r != r || color_.g != g || color_.b != b || color_.a != a) {
+        color_.r = r;
+        color_.g = g;
+        color_.b = b;
+        color_.a = a;
+        selected_root_ = nullptr;
+    }
+}
+
+bool PointPyramid::isCurrent(const PointStore& points) const {
+    if (points.getChunkCount() != tree_.chunks.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < tree_.chunks.size(); ++i) {
+        if (&points.getChunk(i) != tree_.chunks[i].chunk.get()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PointPyramid::update(const PointStore& points) {
+    if (pending_ && pending_->ready.load(std::memory_order_acquire)) {
+        adopt();
+    }
+    if (pending_ || isCurrent(points)) {
+        return;
+    }
+    
+    // Refresh chunk summaries here: the snapshot shares the chunks and the
+    // builder must not write to them
+    double min_x, min_y, max_x, max_y;
+    points.getBounds(min_x, min_y, max_x, max_y);
+    
+    auto job = std::make_shared<PendingBuild>();
+    job->tree = tree_;
+    pending_ = job;
+    builder_.run([job, snapshot = points]() {
+        build(job->tree, snapshot);
+        job->ready.store(true, std::memory_order_release);
+    });
+}
+
+void PointPyramid::waitForBuild() {
+    if (pending_) {
+        adopt();
+    }
+}
+
+void PointPyramid::adopt() {
+    builder_.wait();
+    tree_ = std::move(pending_->tree);
+    pending_.reset();
+    selected_root_ = nullptr;
+}
+
+void PointPyramid::build(Tree& tree, const PointStore& points) {
+    if (!tree.root) {
+        rebuild(tree, points, 0.0);
+        return;
+    }
+    
+    // Pair chunks by position. The same chunk object holds the same points;
+    // a changed one either extends the recorded chunk or replaces its points.
+    struct Change {
+        size_t index;
+        std::shared_ptr<const PointChunk> old;  // Points to take out, null if none
+        size_t first;                           // First point of the store's chunk to insert
+    };
+    std::vector<Change> changes;
+    size_t chunk_count = points.getChunkCount();
+    size_t changed_points = 0;
+    const Node& root = *tree.root;
+    for (size_t i = 0; i < std::max(chunk_count, tree.chunks.size()); ++i) {
+        const PointChunk* chunk = i < chunk_count ? &points.getChunk(i) : nullptr;
+        const ChunkRecord* record = i < tree.chunks.size() ? &tree.chunks[i] : nullptr;
+        if (record && chunk == record->chunk.get()) {
+            continue;
+        }
+        Change change{i, nullptr, 0};
+        if (record && chunk && isPrefix(*record->chunk, *chunk)) {
+            change.first = record->chunk->points.size();
+        } else if (record) {
+            change.old = record->chunk;
+            changed_points += record->chunk->live;
+        }
+        if (chunk) {
+            changed_points += chunk->points.size() - change.first;
+            // New points outside the root square: rebuild with at least twice
+            // the size, so a store growing in one direction rebuilds logarithmically often
+            if (chunk->live > 0 &&
+                (chunk->min_x < root.min_x || chunk->min_y < root.min_y ||
+                 chunk->max_x > root.min_x + root.size || chunk->max_y > root.min_y + root.size)) {
+                rebuild(tree, points, root.size * 2.0);
+                return;
+            }
+        }
+        changes.push_back(change);
+    }
+    if (changed_points > tree.point_count / 2) {
+        rebuild(tree, points, 0.0);
+        return;
+    }
+    
+    for (const Change& change : changes) {
+        if (change.old) {
+            const PointChunk& old = *change.old;
+            for (size_t k = 0; k < old.points.size(); ++k) {
+                if (!old.isDead(k)) {
+                    remove(tree, old.points[k].getX(), old.points[k].getY());
+                }
+            }
+        }
+    }
+    tree.chunks.resize(chunk_count);
+    for (const Change& change : changes) {
+        if (change.index >= chunk_count) {
+            continue;
+        }
+        const PointChunk& chunk = points.getChunk(change.index);
+        for (size_t k = change.first; k < chunk.points.size(); ++k) {
+            if (!chunk.isDead(k)) {
+                insert(tree, chunk.points[k].getX(), chunk.points[k].getY());
+            }
+        }
+        tree.chunks[change.index] = ChunkRecord{points.shareChunk(change.index)};
+    }
+}
+
+void PointPyramid::rebuild(Tree& tree, const PointStore& points, double min_size) {
+    tree = Tree();
+    tree.chunks.resize(points.getChunkCount());
+    double min_x, min_y, max_x, max_y;
+    if (points.getBounds(min_x, min_y, max_x, max_y)) {
+        // Square root cell with a margin for points appended near the edges
+        double size = std::max(max_x - min_x, max_y - min_y);
+        size = size > 0.0 ? size * (1.0 + 1.0 / 16.0) : 1.0;
+        size = std::max(size, min_size);
+        tree.root = std::make_shared<Node>();
+        tree.root->min_x = (min_x + max_x - size) * 0.5;
+        tree.root->min_y = (min_y + max_y - size) * 0.5;
+        tree.root->size = size;
+        tree.root->depth = 0;
+        tree.node_count = 1;
+    }
+    for (size_t i = 0; i < points.getChunkCount(); ++i) {
+        const PointChunk& chunk = points.getChunk(i);
+        for (size_t k = 0; k < chunk.points.size(); ++k) {
+            if (!chunk.isDead(k)) {
+                insert(tree, chunk.points[k].getX(), chunk.points[k].getY());
+            }
+        }
+        tree.chunks[i] = ChunkRecord{points.shareChunk(i)};
+    }
+}
+
+void PointPyramid::insert(Tree& tree, double x, double y) {
+    Node* node = writableRoot(tree);
+    while (true) {
+        double scale = GRID_RESOLUTION / node->size;
+        int cell_x = std::clamp(static_cast<int>((x - node->min_x) * scale), 0, GRID_RESOLUTION - 1);
+        int cell_y = std::clamp(static_cast<int>((y - node->min_y) * scale), 0, GRID_RESOLUTION - 1);
+        size_t cell = static_cast<size_t>(cell_y) * GRID_RESOLUTION + cell_x;
+        uint64_t bit = uint64_t(1) << (cell % 64);
+        if (node->depth == MAX_DEPTH || !(node->occupied[cell / 64] & bit)) {
+            node->occupied[cell / 64] |= bit;
+            node->xy.push_back(static_cast<float>(x));
+            node->xy.push_back(static_cast<float>(y));
+            node->cells.push_back(static_cast<uint16_t>(cell));
+            tree.point_count++;
+            return;
+        }
+        
+        // The quadrant follows from the cell, so rounding cannot disagree with it
+        int quadrant = (cell_x >= GRID_RESOLUTION / 2 ? 1 : 0) | (cell_y >= GRID_RESOLUTION / 2 ? 2 : 0);
+        node = writableChild(tree, *node, quadrant);
+    }
+}
+
+bool PointPyramid::remove(Tree& tree, double x, double y) {
+    // Down the path insert() takes: the point sits in the first node along
+    // it whose cell holds these coordinates
+    float fx = static_cast<float>(x);
+    float fy = static_cast<float>(y);
+    Node* node = writableRoot(tree);
+    while (true) {
+        double scale = GRID_RESOLUTION / node->size;
+        int cell_x = std::clamp(static_cast<int>((x - node->min_x) * scale), 0, GRID_RESOLUTION - 1);
+        int cell_y = std::clamp(static_cast<int>((y - node->min_y) * scale), 0, GRID_RESOLUTION - 1);
+        size_t cell = static_cast<size_t>(cell_y) * GRID_RESOLUTION + cell_x;
+        uint64_t bit = uint64_t(1) << (cell % 64);
+        if (node->occupied[cell / 64] & bit) {
+            for (size_t k = 0; k < node->cells.size(); ++k) {
+                if (node->cells[k] != cell || node->xy[k * 2] != fx || node->xy[k * 2 + 1] != fy) {
+                    continue;
+                }
+                size_t last = node->cells.size() - 1;
+                node->cells[k] = node->cells[last];
+                node->xy[k * 2] = node->xy[last * 2];
+                node->xy[k * 2 + 1] = node->xy[last * 2 + 1];
+                node->cells.pop_back();
+                node->xy.resize(last * 2);
+                // Deepest nodes keep any number of points per cell
+                if (node->depth < MAX_DEPTH) {
+                    node->occupied[cell / 64] &= ~bit;
+                }
+                tree.point_count--;
+                return true;
+            }
+        }
+        
+        int quadrant = (cell_x >= GRID_RESOLUTION / 2 ? 1 : 0) | (cell_y >= GRID_RESOLUTION / 2 ? 2 : 0);
+        if (node->depth == MAX_DEPTH || !node->children[quadrant]) {
+            return false;
+        }
+        node = writableChild(tree, *node, quadrant);
+    }
+}
+
+PointPyramid::Node* PointPyramid::writableRoot(Tree& tree) {
+    if (tree.root.use_count() > 1) {
+        tree.root = std::make_shared<Node>(*tree.root);
+    }
+    return tree.root.get();
+}
+
+PointPyramid::Node* PointPyramid::writableChild(Tree& tree, Node& parent, int quadrant) {
+    std::shared_ptr<Node>& child = parent.children[quadrant];
+    if (!child) {
+        double half = parent.size * 0.5;
+        child = std::make_shared<Node>();
+        child->min_x = parent.min_x + ((quadrant & 1) ? half : 0.0);
+        child->min_y = parent.min_y + ((quadrant & 2) ? half : 0.0);
+        child->size = half;
+        child->depth = parent.depth + 1;
+        tree.node_count++;
+    } else if (child.use_count() > 1) {
+        // Still part of the adopted tree
+        child = std::make_shared<Node>(*child);
+    }
+    return child.get();
+}
+
+bool PointPyramid::isPrefix(const PointChunk& prefix, const PointChunk& chunk) {
+    // Same coordinates and tombstones for every point of prefix
+    if (chunk.points.size() < prefix.points.size()) {
+        return false;
+    }
+    for (size_t k = 0; k < prefix.points.size(); ++k) {
+        if (prefix.isDead(k) != chunk.isDead(k) ||
+            prefix.points[k].getX() != chunk.points[k].getX() ||
+            prefix.points[k].getY() != chunk.points[k].getY()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<Vertex3D>& PointPyramid::select(const OpenGLRenderer& renderer) {
+    ClipTransform transform(renderer.getProjectionMatrix(), renderer.getModelViewMatrix());
+    const float* mvp = transform.mvp;
+    int width = renderer.getViewportWidth();
+    int height = renderer.getViewportHeight();
+    if (selected_root_ && selected_root_ == tree_.root.get() &&
+        std::memcmp(mvp, selected_mvp_, sizeof(selected_mvp_)) == 0 &&
+        width == selected_width_ && height == selected_height_ &&
+        vertex_budget_ == selected_budget_ && max_screen_error_ == selected_error_) {
+        return vertices_;
+    }
+    
+    stats_ = PyramidStats();
+    vertices_.clear();
+    selected_root_ = tree_.root.get();
+    std::memcpy(selected_mvp_, mvp, sizeof(selected_mvp_));
+    selected_width_ = width;
+    selected_height_ = height;
+    selected_budget_ = vertex_budget_;
+    selected_error_ = max_screen_error_;
+    if (!tree_.root) {
+        return vertices_;
+    }
+    
+    // Largest nodes on screen first, so the budget runs out on fine detail
+    Frustum frustum = Frustum::fromTransform(transform);
+    using Entry = std::pair<float, const Node*>;
+    std::priority_queue<Entry> queue;
+    const Node* root = tree_.root.get();
+    queue.emplace(transform.projectedExtent(root->min_x, root->min_y, root->min_x + root->size, root->min_y + root->size,
+                                           width, height), root);
+    while (!queue.empty()) {
+        float extent = queue.top().first;
+        const Node& node = *queue.top().second;
+        queue.pop();
+        stats_.nodes_visited++;
+        if (!frustum.intersectsBox(static_cast<float>(node.min_x), static_cast<float>(node.min_y), 0.0f,
+                                   static_cast<float>(node.min_x + node.size),
+                                   static_cast<float>(node.min_y + node.size), 0.0f)) {
+            stats_.nodes_culled++;
+            continue;
+        }
+        size_t count = node.xy.size() / 2;
+        if (vertices_.size() + count > vertex_budget_) {
+            stats_.budget_reached = true;
+            break;
+        }
+        
+        size_t first = vertices_.size();
+        vertices_.resize(first + count, color_);
+        for (size_t k = 0; k < count; ++k) {
+            vertices_[first + k].x = node.xy[k * 2];
+            vertices_[first + k].y = node.xy[k * 2 + 1];
+        }
+        
+        // Children only while this level's spacing is still visible
+        if (extent / GRID_RESOLUTION > max_screen_error_) {
+            for (const std::shared_ptr<Node>& child : node.children) {
+                if (child) {
+                    float child_extent = transform.projectedExtent(child->min_x, child->min_y, child->min_x + child->size,
+                                                                   child->min_y + child->size, width, height);
+                    queue.emplace(child_extent, child.get());
+                }
+            }
+        }
+    }
+    stats_.points_submitted = vertices_.size();
+    return vertices_;
+}
+
+void PointPyramid::draw(OpenGLRenderer& renderer) {
+    RenderStats& render_stats = renderer.getRenderStats();
+    {
+        RenderStageTimer timer(render_stats, RenderStage::CULL);
+        select(renderer);
+    }
+    render_stats.addCulling(stats_.nodes_visited, stats_.nodes_culled, tree_.point_count, stats_.points_submitted);
+    if (!vertices_.empty()) {
+        renderer.drawPoints(vertices_);
+    }
+}
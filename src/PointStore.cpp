@@ -0,0 +1,585 @@
+#include "../include/PointStore.h"
+#include "../include/TaskScheduler.h"
+#include <algorithm>
+#include <limits>
+#include <bit>
+
+PointChunk::PointChunk()
+    : live(0), min_x(std::numeric_limits<double>::max()), min_y(std::numeric_limits<double>::max()),
+      max_x(std::numeric_limits<double>::lowest()), max_y(std::numeric_limits<double>::lowest()),
+      has_unassigned_cs(false), summary_dirty(false), version(nextVersion()) {
+}
+
+uint64_t PointChunk::nextVersion() {
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void PointChunk::kill(size_t offset) {
+    if (dead.empty()) {
+        dead.assign(PointStore::CHUNK_SIZE / 64, 0);
+    }
+    dead[offset / 64] |= uint64_t(1) << (offset % 64);
+    --live;
+    summary_dirty = true;
+}
+
+size_t PointChunk::findLive(size_t rank) const {
+    if (dead.empty()) {
+        return rank;
+    }
+    // Skip whole words by popcount, then select the bit inside the word
+    for (size_t word = 0; word * 64 < points.size(); ++word) {
+        size_t valid = std::min<size_t>(64, points.size() - word * 64);
+        uint64_t mask = valid == 64 ? ~uint64_t(0) : (uint64_t(1) << valid) - 1;
+        uint64_t alive = ~dead[word] & mask;
+        size_t count = static_cast<size_t>(std::popcount(alive));
+        if (rank < count) {
+            for (; rank > 0; --rank) {
+                alive &= alive - 1;
+            }
+            return word * 64 + static_cast<size_t>(std::countr_zero(alive));
+        }
+        rank -= count;
+    }
+    return points.size();
+}
+
+void PointChunk::include(const Point2D& point) {
+    double x = point.getX();
+    double y = point.getY();
+    min_x = std::min(min_x, x);
+    min_y = std::min(min_y, y);
+    max_x = std::max(max_x, x);
+    max_y = std::max(max_y, y);
+    has_unassigned_cs = has_unassigned_cs || !point.hasCoordinateSystem();
+}
+
+void PointChunk::refresh() {
+    min_x = min_y = std::numeric_limits<double>::max();
+    max_x = max_y = std::numeric_limits<double>::lowest();
+    has_unassigned_cs = false;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (!isDead(i)) {
+            include(points[i]);
+        }
+    }
+    summary_dirty = false;
+}
+
+PointStore::PointStore() : size_(0), tombstones_(0), revision_(0), tree_valid_(false) {
+    resetBounds();
+}
+
+PointStore::PointStore(const PointStore& other) : PointStore() {
+    *this = other;
+}
+
+PointStore& PointStore::operator=(const PointStore& other) {
+    if (this != &other) {
+        // Only unshared chunks can be dirty, settle them before sharing
+        other.refreshDirtyChunks();
+        chunks_ = other.chunks_;
+        size_ = other.size_;
+        tombstones_ = other.tombstones_;
+        live_tree_ = other.live_tree_;
+        tree_valid_ = other.tree_valid_;
+        pending_.reset();
+        ++revision_;
+        min_x_ = other.min_x_;
+        min_y_ = other.min_y_;
+        max_x_ = other.max_x_;
+        max_y_ = other.max_y_;
+        bounds_valid_ = other.bounds_valid_;
+    }
+    return *this;
+}
+
+void PointStore::refreshDirtyChunks() const {
+    for (const auto& chunk : chunks_) {
+        if (chunk->summary_dirty) {
+            chunk->refresh();
+        }
+    }
+}
+
+PointChunk& PointStore::mutableChunk(size_t chunk_index) {
+    std::shared_ptr<PointChunk>& chunk = chunks_[chunk_index];
+    if (chunk.use_count() > 1) {
+        // Shared with another store, clone before writing
+        auto clone = std::make_shared<PointChunk>(*chunk);
+        clone->points.reserve(CHUNK_SIZE);
+        chunk = std::move(clone);
+    }
+    chunk->version = PointChunk::nextVersion();
+    return *chunk;
+}
+
+Point2D* PointStore::mutableAt(size_t index) {
+    if (index >= size_) {
+        return nullptr;
+    }
+    size_t chunk_index = index / CHUNK_SIZE;
+    size_t offset = index % CHUNK_SIZE;
+    if (tombstones_ > 0) {
+        locate(index, chunk_index, offset);
+    }
+    
+    // The caller may move the point, refresh the summary on next use
+    PointChunk& chunk = mutableChunk(chunk_index);
+    chunk.summary_dirty = true;
+    bounds_valid_ = false;
+    ++revision_;
+    return &chunk.points[offset];
+}
+
+std::vector<Point2D*> PointStore::mutablePoints() {
+    std::vector<Point2D*> result;
+    result.reserve(size_);
+    for (size_t c = 0; c < chunks_.size(); ++c) {
+        PointChunk& chunk = mutableChunk(c);
+        chunk.summary_dirty = true;
+        for (size_t offset = 0; offset < chunk.points.size(); ++offset) {
+            if (!chunk.isDead(offset)) {
+                result.push_back(&chunk.points[offset]);
+            }
+        }
+    }
+    bounds_valid_ = false;
+    ++revision_;
+    return result;
+}
+
+PointChunk& PointStore::appendChunk() {
+    if (chunks_.empty() || chunks_.back()->points.size() == CHUNK_SIZE) {
+        auto chunk = std::make_shared<PointChunk>();
+        chunk->points.reserve(CHUNK_SIZE);
+        chunks_.push_back(std::move(chunk));
+        if (tree_valid_) {
+            // New Fenwick node covers the chunks (i - lowbit(i), i], the new one is empty
+            size_t i = chunks_.size();
+            live_tree_.push_back(treePrefix(i - 1) - treePrefix(i - (i & (~i + 1))));
+        }
+    }
+    ++revision_;
+    return mutableChunk(chunks_.size() - 1);
+}
+
+void PointStore::append(const Point2D& point) {
+    PointChunk& chunk = appendChunk();
+    chunk.points.push_back(point);
+    chunk.include(point);
+    ++chunk.live;
+    ++size_;
+    if (tree_valid_) {
+        treeAdd(chunks_.size() - 1, 1);
+    }
+    if (bounds_valid_) {
+        min_x_ = std::min(min_x_, chunk.min_x);
+        min_y_ = std::min(min_y_, chunk.min_y);
+        max_x_ = std::max(max_x_, chunk.max_x);
+        max_y_ = std::max(max_y_, chunk.max_y);
+    }
+    recordEdit(true, 1);
+}
+
+void PointStore::append(double x, double y, CS* cs) {
+    PointChunk& chunk = appendChunk();
+    chunk.points.emplace_back(x, y, cs);
+    chunk.include(chunk.points.back());
+    ++chunk.live;
+    ++size_;
+    if (tree_valid_) {
+        treeAdd(chunks_.size() - 1, 1);
+    }
+    if (bounds_valid_) {
+        min_x_ = std::min(min_x_, x);
+        min_y_ = std::min(min_y_, y);
+        max_x_ = std::max(max_x_, x);
+        max_y_ = std::max(max_y_, y);
+    }
+    recordEdit(true, 1);
+}
+
+size_t PointStore::appendCoordinates(std::span<const double> xs, std::span<const double> ys, CS* cs) {
+    size_t count = std::min(xs.size(), ys.size());
+    reserve(size_ + count);
+    
+    size_t done = 0;
+    while (done < count) {
+        PointChunk& chunk = appendChunk();
+        size_t take = std::min(count - done, CHUNK_SIZE - chunk.points.size());
+        
+        // Plain min/max over the coordinate arrays, then one merge into the chunk
+        double min_x = chunk.min_x, min_y = chunk.min_y;
+        double max_x = chunk.max_x, max_y = chunk.max_y;
+        for (size_t i = done; i < done + take; ++i) {
+            min_x = std::min(min_x, xs[i]);
+            max_x = std::max(max_x, xs[i]);
+            min_y = std::min(min_y, ys[i]);
+            max_y = std::max(max_y, ys[i]);
+        }
+        for (size_t i = done; i < done + take; ++i) {
+            chunk.points.emplace_back(xs[i], ys[i], cs);
+        }
+        chunk.min_x = min_x;
+        chunk.min_y = min_y;
+        chunk.max_x = max_x;
+        chunk.max_y = max_y;
+        chunk.has_unassigned_cs = chunk.has_unassigned_cs || (take > 0 && cs == nullptr);
+        chunk.live += static_cast<uint32_t>(take);
+        if (tree_valid_) {
+            treeAdd(chunks_.size() - 1, static_cast<long>(take));
+        }
+        
+        if (bounds_valid_) {
+            min_x_ = std::min(min_x_, min_x);
+            min_y_ = std::min(min_y_, min_y);
+            max_x_ = std::max(max_x_, max_x);
+            max_y_ = std::max(max_y_, max_y);
+        }
+        size_ += take;
+        done += take;
+    }
+    recordEdit(true, count);
+    return count;
+}
+
+void PointStore::reserve(size_t count) {
+    chunks_.reserve((count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+}
+
+void PointStore::removeAt(size_t index) {
+    if (index >= size_) {
+        return;
+    }
+    if (!tree_valid_) {
+        buildTree();
+    }
+    
+    // Tombstone only, the point is dropped by the next compaction
+    size_t chunk_index, offset;
+    locate(index, chunk_index, offset);
+    mutableChunk(chunk_index).kill(offset);
+    treeAdd(chunk_index, -1);
+    --size_;
+    ++tombstones_;
+    bounds_valid_ = false;
+    ++revision_;
+    recordEdit(false, index);
+}
+
+void PointStore::clear() {
+    chunks_.clear();
+    size_ = 0;
+    tombstones_ = 0;
+    live_tree_.clear();
+    tree_valid_ = false;
+    pending_.reset();
+    ++revision_;
+    resetBounds();
+}
+
+size_t PointStore::removeSelection(const std::vector<bool>& selected) {
+    std::vector<size_t> starts(chunks_.size() + 1, 0);
+    for (size_t c = 0; c < chunks_.size(); ++c) {
+        starts[c + 1] = starts[c] + chunks_[c]->live;
+    }
+    
+    std::atomic<size_t> removed(0);
+    TaskScheduler::instance().parallelFor(0, chunks_.size(), [&](size_t begin, size_t end) {
+        size_t local = 0;
+        for (size_t c = begin; c < end; ++c) {
+            if (starts[c] >= selected.size()) {
+                break;
+            }
+            // A clone keeps the same points, so reading through the slot stays valid
+            const std::shared_ptr<PointChunk>& source = chunks_[c];
+            PointChunk* target = nullptr;
+            size_t logical = starts[c];
+            for (size_t offset = 0; offset < source->points.size(); ++offset) {
+                if (source->isDead(offset)) {
+                    continue;
+                }
+                if (logical < selected.size() && selected[logical]) {
+                    if (!target) {
+                        target = &mutableChunk(c);
+                    }
+                    target->kill(offset);
+                    ++local;
+                }
+                ++logical;
+            }
+        }
+        removed.fetch_add(local, std::memory_order_relaxed);
+    }, 1);
+    return compactMarked(removed.load());
+}
+
+size_t PointStore::removeIndices(std::vector<size_t> indices) {
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    indices.erase(std::lower_bound(indices.begin(), indices.end(), size_), indices.end());
+    
+    std::vector<size_t> starts(chunks_.size() + 1, 0);
+    for (size_t c = 0; c < chunks_.size(); ++c) {
+        starts[c + 1] = starts[c] + chunks_[c]->live;
+    }
+    
+    TaskScheduler::instance().parallelFor(0, chunks_.size(), [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            auto first = std::lower_bound(indices.begin(), indices.end(), starts[c]);
+            auto last = std::lower_bound(first, indices.end(), starts[c + 1]);
+            if (first == last) {
+                continue;
+            }
+            // Highest rank first so earlier tombstones don't shift later ranks
+            PointChunk& chunk = mutableChunk(c);
+            for (auto it = last; it != first; --it) {
+                chunk.kill(chunk.findLive(*(it - 1) - starts[c]));
+            }
+        }
+    }, 1);
+    return compactMarked(indices.size());
+}
+
+size_t PointStore::compactMarked(size_t removed) {
+    if (removed > 0) {
+        size_ -= removed;
+        tombstones_ += removed;
+        tree_valid_ = false;
+        bounds_valid_ = false;
+        ++revision_;
+        compact();
+    }
+    return removed;
+}
+
+void PointStore::compact() {
+    if (tombstones_ == 0) {
+        return;
+    }
+    pending_.reset();
+    adoptCompacted(buildCompacted(chunks_, size_));
+}
+
+void PointStore::compactIfNeeded() {
+    if (pending_ && pending_->ready.load(std::memory_order_acquire)) {
+        std::shared_ptr<PendingCompaction> job = std::move(pending_);
+        rebaseCompacted(*job);
+    }
+    if (pending_ || tombstones_ == 0 || tombstones_ * COMPACTION_RATIO <= size_ + tombstones_) {
+        return;
+    }
+    
+    // The snapshot shares the chunks, so edits from here on clone instead of racing
+    refreshDirtyChunks();
+    auto job = std::make_shared<PendingCompaction>();
+    job->source = chunks_;
+    job->live = size_;
+    pending_ = job;
+    TaskScheduler::instance().submit([job]() {
+        job->chunks = buildCompacted(job->source, job->live);
+        job->ready.store(true, std::memory_order_release);
+    });
+}
+
+void PointStore::adoptCompacted(ChunkList chunks) {
+    chunks_ = std::move(chunks);
+    tombstones_ = 0;
+    live_tree_.clear();
+    tree_valid_ = false;
+    ++revision_;
+}
+
+void PointStore::rebaseCompacted(PendingCompaction& job) {
+    ChunkList current = std::move(chunks_);
+    adoptCompacted(std::move(job.chunks));
+    size_ = job.live;
+    bounds_valid_ = false;
+    
+    // Same removals and appends in the same order give the same live
+    // sequence; the values of appended points are filled in below
+    for (const ReplayedEdit& edit : job.edits) {
+        if (!edit.append) {
+            removeAt(edit.value);
+            continue;
+        }
+        for (size_t i = 0; i < edit.value; ++i) {
+            append(Point2D());
+        }
+    }
+    
+    // Every write since the snapshot cloned its chunk, so chunks still shared
+    // with the snapshot hold what the job compacted
+    size_t index = 0;
+    for (size_t c = 0; c < current.size(); ++c) {
+        const PointChunk& chunk = *current[c];
+        if (c < job.source.size() && current[c] == job.source[c]) {
+            index += chunk.live;
+            continue;
+        }
+        for (size_t offset = 0; offset < chunk.points.size(); ++offset) {
+            if (!chunk.isDead(offset)) {
+                *mutableAt(index++) = chunk.points[offset];
+            }
+        }
+    }
+}
+
+void PointStore::recordEdit(bool append, size_t value) {
+    if (!pending_) {
+        return;
+    }
+    if (append && !pending_->edits.empty() && pending_->edits.back().append) {
+        pending_->edits.back().value += value;
+        return;
+    }
+    pending_->edits.push_back({append, value});
+}
+
+PointStore::ChunkList PointStore::buildCompacted(const ChunkList& chunks, size_t live_count) {
+    std::vector<size_t> starts(chunks.size() + 1, 0);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        starts[c + 1] = starts[c] + chunks[c]->live;
+    }
+    
+    // Leading full chunks are already in place and stay shared
+    size_t kept = 0;
+    while (kept < chunks.size() && chunks[kept]->live == CHUNK_SIZE) {
+        ++kept;
+    }
+    
+    ChunkList result((live_count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    for (size_t j = 0; j < kept && j < result.size(); ++j) {
+        result[j] = chunks[j];
+    }
+    
+    TaskScheduler::instance().parallelFor(kept, result.size(), [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+            size_t first = j * CHUNK_SIZE;
+            size_t count = std::min(CHUNK_SIZE, live_count - first);
+            auto chunk = std::make_shared<PointChunk>();
+            chunk->points.reserve(CHUNK_SIZE);
+            
+            // Source chunk holding live point number 'first'
+            size_t c = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), first) - starts.begin()) - 1;
+            size_t offset = chunks[c]->findLive(first - starts[c]);
+            while (chunk->points.size() < count && c < chunks.size()) {
+                const PointChunk& source = *chunks[c];
+                for (; offset < source.points.size() && chunk->points.size() < count; ++offset) {
+                    if (!source.isDead(offset)) {
+                        chunk->points.push_back(source.points[offset]);
+                    }
+                }
+                ++c;
+                offset = 0;
+            }
+            chunk->live = static_cast<uint32_t>(chunk->points.size());
+            chunk->refresh();
+            result[j] = std::move(chunk);
+        }
+    }, 1);
+    return result;
+}
+
+void PointStore::locate(size_t index, size_t& chunk_index, size_t& offset) const {
+    // Fenwick descent to the chunk whose live range contains index
+    size_t count = chunks_.size();
+    size_t position = 0;
+    size_t remaining = index;
+    for (size_t step = std::bit_floor(count); step > 0; step >>= 1) {
+        if (position + step <= count && live_tree_[position + step] <= remaining) {
+            position += step;
+            remaining -= live_tree_[position];
+        }
+    }
+    chunk_index = position;
+    offset = chunks_[position]->findLive(remaining);
+}
+
+void PointStore::buildTree() {
+    size_t count = chunks_.size();
+    live_tree_.assign(count + 1, 0);
+    for (size_t i = 1; i <= count; ++i) {
+        live_tree_[i] += chunks_[i - 1]->live;
+        size_t parent = i + (i & (~i + 1));
+        if (parent <= count) {
+            live_tree_[parent] += live_tree_[i];
+        }
+    }
+    tree_valid_ = true;
+}
+
+void PointStore::treeAdd(size_t chunk_index, long delta) {
+    for (size_t i = chunk_index + 1; i < live_tree_.size(); i += i & (~i + 1)) {
+        live_tree_[i] += static_cast<size_t>(delta);
+    }
+}
+
+size_t PointStore::treePrefix(size_t chunk_count) const {
+    size_t sum = 0;
+    for (size_t i = chunk_count; i > 0; i -= i & (~i + 1)) {
+        sum += live_tree_[i];
+    }
+    return sum;
+}
+
+void PointStore::resetBounds() const {
+    min_x_ = min_y_ = std::numeric_limits<double>::max();
+    max_x_ = max_y_ = std::numeric_limits<double>::lowest();
+    bounds_valid_ = true;
+}
+
+void PointStore::assignMissingCoordinateSystem(CS* cs) {
+    if (!cs) {
+        return;
+    }
+    refreshDirtyChunks();
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        if (!chunks_[i]->has_unassigned_cs) {
+            continue;
+        }
+        PointChunk& chunk = mutableChunk(i);
+        for (auto& point : chunk.points) {
+            if (!point.hasCoordinateSystem()) {
+                point.setCoordinateSystem(cs);
+            }
+        }
+        chunk.has_unassigned_cs = false;
+        ++revision_;
+    }
+}
+
+bool PointStore::getBounds(double& min_x, double& min_y, double& max_x, double& max_y) const {
+    if (size_ == 0) {
+        min_x = min_y = max_x = max_y = 0.0;
+        return false;
+    }
+    
+    if (!bounds_valid_) {
+        refreshDirtyChunks();
+        resetBounds();
+        for (const auto& chunk : chunks_) {
+            min_x_ = std::min(min_x_, chunk->min_x);
+            min_y_ = std::min(min_y_, chunk->min_y);
+            max_x_ = std::max(max_x_, chunk->max_x);
+            max_y_ = std::max(max_y_, chunk->max_y);
+        }
+    }
+    min_x = min_x_;
+    min_y = min_y_;
+    max_x = max_x_;
+    max_y = max_y_;
+    return true;
+}
+
+size_t PointStore::getSharedChunkCount() const {
+    size_t shared = 0;
+    for (const auto& chunk : chunks_) {
+        if (chunk.use_count() > 1) {
+            ++shared;
+        }
+    }
+    return shared;
+}
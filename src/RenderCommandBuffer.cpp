@@ -0,0 +1,138 @@
+#include "../include/RenderCommandBuffer.h"
+#include <algorithm>
+
+namespace {
+
+// State key bits, depth-tested draws sort before the rest
+const uint64_t OVERLAY_BIT = uint64_t(1) << 63;
+const uint64_t LIGHTING_BIT = uint64_t(1) << 62;
+const int MATERIAL_SHIFT = 30;
+const int PRIMITIVE_SHIFT = 28;
+const uint64_t RETAINED_BIT = uint64_t(1) << 27;
+
+size_t verticesPerPrimitive(PrimitiveType primitive) {
+    switch (primitive) {
+        case PrimitiveType::TRIANGLES: return 3;
+        case PrimitiveType::LINES: return 2;
+        case PrimitiveType::POINTS: return 1;
+    }
+    return 1;
+}
+
+} // namespace
+
+RenderCommandBuffer::RenderCommandBuffer()
+    : depth_test_(true), lighting_(false), material_(0) {
+}
+
+void RenderCommandBuffer::draw(PrimitiveType primitive, const Vertex3D* vertices, size_t count) {
+    // Whole primitives only: leftover vertices would pair up with the next
+    // draw once merged. Drawn on their own they are ignored anyway.
+    count -= count % verticesPerPrimitive(primitive);
+    if (count == 0) {
+        return;
+    }
+    size_t first = vertices_.size();
+    vertices_.insert(vertices_.end(), vertices, vertices + count);
+    record(primitive, 0, first, count);
+}
+
+void RenderCommandBuffer::drawBuffer(BufferHandle handle, PrimitiveType primitive, size_t first_vertex, size_t count) {
+    record(primitive, handle, first_vertex, count);
+}
+
+void RenderCommandBuffer::record(PrimitiveType primitive, BufferHandle buffer, size_t first, size_t count) {
+    Command command;
+    command.state = (depth_test_ ? 0 : OVERLAY_BIT) |
+                    (lighting_ ? LIGHTING_BIT : 0) |
+                    (static_cast<uint64_t>(material_) << MATERIAL_SHIFT) |
+                    (static_cast<uint64_t>(primitive) << PRIMITIVE_SHIFT) |
+                    (buffer != 0 ? RETAINED_BIT : 0);
+    command.sequence = static_cast<uint32_t>(commands_.size());
+    command.sort_key = depth_test_ ? command.state : OVERLAY_BIT | command.sequence;
+    command.primitive = primitive;
+    command.buffer = buffer;
+    command.first = first;
+    command.count = count;
+    commands_.push_back(command);
+}
+
+void RenderCommandBuffer::submit(OpenGLRenderer& renderer) {
+    stats_ = RenderCommandStats();
+    stats_.commands = commands_.size();
+    size_t draw_calls_before = renderer.getUploadStats().draw_calls;
+    
+    {
+        RenderStageTimer timer(renderer.getRenderStats(), RenderStage::SORT);
+        std::sort(commands_.begin(), commands_.end(), [](const Command& a, const Command& b) {
+            return a.sort_key != b.sort_key ? a.sort_key < b.sort_key : a.sequence < b.sequence;
+        });
+    }
+    
+    bool material_known = false;
+    uint32_t material = 0;
+    for (size_t i = 0; i < commands_.size(); ++i) {
+        const Command& command = commands_[i];
+        applyState(renderer, command, material_known, material);
+        if (command.buffer != 0) {
+            renderer.drawBuffer(command.buffer, command.primitive, command.first, command.count);
+            continue;
+        }
+        
+        // Gather the run of immediate draws sharing this state
+        merged_.assign(vertices_.begin() + command.first, vertices_.begin() + command.first + command.count);
+        while (i + 1 < commands_.size()) {
+            const Command& next = commands_[i + 1];
+            if (next.state != command.state || merged_.size() + next.count > MAX_MERGED_VERTICES) {
+                break;
+            }
+            merged_.insert(merged_.end(), vertices_.begin() + next.first, vertices_.begin() + next.first + next.count);
+            ++i;
+        }
+        drawMerged(renderer, command.primitive);
+    }
+    
+    stats_.draw_calls = renderer.getUploadStats().draw_calls - draw_calls_before;
+    clear();
+}
+
+void RenderCommandBuffer::applyState(OpenGLRenderer& renderer, const Command& command, bool& material_known, uint32_t& material) {
+    bool depth_test = (command.state & OVERLAY_BIT) == 0;
+    bool lighting = (command.state & LIGHTING_BIT) != 0;
+    uint32_t command_material = static_cast<uint32_t>(command.state >> MATERIAL_SHIFT);
+    if (renderer.isDepthTestEnabled() != depth_test) {
+        renderer.enableDepthTest(depth_test);
+        stats_.state_changes++;
+    }
+    if (renderer.isLightingEnabled() != lighting) {
+        renderer.enableLighting(lighting);
+        stats_.state_changes++;
+    }
+    if (!material_known || material != command_material) {
+        material = command_material;
+        material_known = true;
+        if (material_callback_) {
+            material_callback_(material);
+            stats_.state_changes++;
+        }
+    }
+}
+
+void RenderCommandBuffer::drawMerged(OpenGLRenderer& renderer, PrimitiveType primitive) {
+    switch (primitive) {
+        case PrimitiveType::TRIANGLES:
+            renderer.drawTriangles(merged_);
+            break;
+        case PrimitiveType::LINES:
+            renderer.drawLines(merged_);
+            break;
+        case PrimitiveType::POINTS:
+            renderer.drawPoints(merged_);
+            break;
+    }
+}
+
+void RenderCommandBuffer::clear() {
+    commands_.clear();
+    vertices_.clear();
+}
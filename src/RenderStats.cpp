@@ -0,0 +1,169 @@
+#include "../include/RenderStats.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+const double RenderStats::BUCKET_LIMITS[RenderStats::HISTOGRAM_BUCKETS - 1] = {
+    1.0, 2.0, 4.0, 8.0, 16.7, 33.3, 50.0, 100.0, 250.0
+};
+
+RenderStats::RenderStats() {
+    reset();
+}
+
+void RenderStats::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_frame_ = false;
+    current_ = RenderFrameStats();
+    last_ = RenderFrameStats();
+    frame_count_ = 0;
+    total_frame_milliseconds_ = 0.0;
+    std::fill(histogram_, histogram_ + HISTOGRAM_BUCKETS, 0);
+    recent_.clear();
+    recent_next_ = 0;
+}
+
+void RenderStats::beginFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_frame_ = true;
+    current_ = RenderFrameStats();
+    frame_start_ = std::chrono::steady_clock::now();
+}
+
+void RenderStats::endFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!in_frame_) {
+        return;
+    }
+    in_frame_ = false;
+    current_.frame_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start_).count();
+    last_ = current_;
+    frame_count_++;
+    total_frame_milliseconds_ += current_.frame_milliseconds;
+    
+    int bucket = static_cast<int>(std::upper_bound(BUCKET_LIMITS, BUCKET_LIMITS + HISTOGRAM_BUCKETS - 1,
+                                                   current_.frame_milliseconds) - BUCKET_LIMITS);
+    histogram_[bucket]++;
+    if (recent_.size() < FRAME_WINDOW) {
+        recent_.push_back(current_.frame_milliseconds);
+    } else {
+        recent_[recent_next_] = current_.frame_milliseconds;
+        recent_next_ = (recent_next_ + 1) % FRAME_WINDOW;
+    }
+}
+
+bool RenderStats::isInFrame() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_frame_;
+}
+
+void RenderStats::addStageTime(RenderStage stage, double milliseconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.stage_milliseconds[static_cast<int>(stage)] += milliseconds;
+}
+
+void RenderStats::addDraw(size_t primitives, size_t vertices) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.draw_calls++;
+    current_.primitives += primitives;
+    current_.vertices += vertices;
+}
+
+void RenderStats::addUploadedBytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.bytes_uploaded += bytes;
+}
+
+void RenderStats::addCulling(size_t chunks_tested, size_t chunks_culled, size_t points_visible, size_t points_submitted) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    current_.chunks_tested += chunks_tested;
+    current_.chunks_culled += chunks_culled;
+    current_.points_visible += points_visible;
+    current_.points_submitted += points_submitted;
+}
+
+uint64_t RenderStats::getFrameCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_count_;
+}
+
+RenderFrameStats RenderStats::getLastFrame() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_;
+}
+
+std::vector<uint64_t> RenderStats::getHistogram() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::vector<uint64_t>(histogram_, histogram_ + HISTOGRAM_BUCKETS);
+}
+
+double RenderStats::getFramePercentile(double percentile) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return percentileLocked(percentile);
+}
+
+double RenderStats::percentileLocked(double percentile) const {
+    if (recent_.empty()) {
+        return 0.0;
+    }
+    std::vector<double> sorted = recent_;
+    std::sort(sorted.begin(), sorted.end());
+    double rank = std::clamp(percentile, 0.0, 100.0) / 100.0 * (sorted.size() - 1);
+    return sorted[static_cast<size_t>(rank + 0.5)];
+}
+
+double RenderStats::getAverageFrameMilliseconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_count_ > 0 ? total_frame_milliseconds_ / frame_count_ : 0.0;
+}
+
+const char* RenderStats::getStageName(RenderStage stage) {
+    switch (stage) {
+        case RenderStage::CULL: return "cull";
+        case RenderStage::SORT: return "sort";
+        case RenderStage::GEOMETRY: return "geometry";
+        case RenderStage::RASTER: return "raster";
+        default: return "unknown";
+    }
+}
+
+std::string RenderStats::format() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::stringstream result;
+    result << std::fixed << std::setprecision(2);
+    result << "Frames: " << frame_count_ << "\n";
+    if (frame_count_ == 0) {
+        return result.str();
+    }
+    
+    const RenderFrameStats& frame = last_;
+    result << "Last frame: " << frame.frame_milliseconds << " ms, "
+           << frame.draw_calls << " draw calls, "
+           << frame.primitives << " primitives, "
+           << frame.vertices << " vertices, "
+           << frame.bytes_uploaded << " bytes uploaded\n";
+    if (frame.chunks_tested > 0) {
+        result << "Culling: " << frame.chunks_culled << "/" << frame.chunks_tested << " chunks culled, "
+               << frame.points_submitted << "/" << frame.points_visible << " visible points submitted\n";
+    }
+    result << "Stages (ms):";
+    for (int i = 0; i < static_cast<int>(RenderStage::COUNT); ++i) {
+        result << " " << getStageName(static_cast<RenderStage>(i)) << " " << frame.stage_milliseconds[i];
+    }
+    result << "\n";
+    result << "Frame time: avg " << total_frame_milliseconds_ / frame_count_
+           << ", p50 " << percentileLocked(50.0)
+           << ", p95 " << percentileLocked(95.0)
+           << ", p99 " << percentileLocked(99.0) << " ms\n";
+    
+    result << "Histogram:\n";
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        if (i < HISTOGRAM_BUCKETS - 1) {
+            result << "  <= " << std::setw(6) << BUCKET_LIMITS[i] << " ms: ";
+        } else {
+            result << "   > " << std::setw(6) << BUCKET_LIMITS[i - 1] << " ms: ";
+        }
+        result << histogram_[i] << "\n";
+    }
+    return result.str();
+}
@@ -0,0 +1,227 @@
+#include "../include/RenderThread.h"
+#include <algorithm>
+#include <cassert>
+
+SceneSnapshot::SceneSnapshot() {
+    reset();
+}
+
+void SceneSnapshot::reset() {
+    frame = 0;
+    viewport_width = 800;
+    viewport_height = 600;
+    for (int i = 0; i < 16; ++i) {
+        projection[i] = model_view[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+    clear_color[0] = clear_color[1] = clear_color[2] = 0.0f;
+    clear_color[3] = 1.0f;
+    batches.clear();
+    point_layers.clear();
+}
+
+void SceneSnapshot::setProjectionMatrix(const float* matrix) {
+    std::copy(matrix, matrix + 16, projection);
+}
+
+void SceneSnapshot::setModelViewMatrix(const float* matrix) {
+    std::copy(matrix, matrix + 16, model_view);
+}
+
+void SceneSnapshot::addBatch(PrimitiveType primitive, const std::vector<Vertex3D>& vertices,
+                             bool depth_test, bool lighting, uint32_t material) {
+    batches.push_back(SceneBatch{primitive, depth_test, lighting, material, vertices});
+}
+
+void SceneSnapshot::addPoints(const PointStore& points, float r, float g, float b, float a) {
+    // Copying a store only shares its chunks
+    point_layers.push_back(ScenePointLayer{points, r, g, b, a});
+}
+
+RenderThread::RenderThread(OpenGLRenderer& renderer)
+    : renderer_(renderer), back_(0), front_(1), ready_(2), next_frame_(1),
+      running_(false), target_fps_(60.0), rendered_frame_(0) {
+}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+SceneSnapshot& RenderThread::beginSnapshot() {
+    SceneSnapshot& snapshot = slots_[back_];
+    snapshot.reset();
+    return snapshot;
+}
+
+uint64_t RenderThread::publish() {
+    uint64_t frame = next_frame_++;
+    slots_[back_].frame = frame;
+    
+    // Hand the back slot over and take whatever was ready as the new back slot
+    uint32_t previous = ready_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+    back_ = previous & SLOT_MASK;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.snapshots_published++;
+        if (previous & FRESH) {
+            stats_.snapshots_dropped++;
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_one();
+    return frame;
+}
+
+void RenderThread::start() {
+    if (running_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    thread_ = std::thread(&RenderThread::threadLoop, this);
+}
+
+void RenderThread::setOnFrameRendered(std::function<void(const SceneSnapshot&)> callback) {
+    // The thread reads the callback without a lock
+    assert(!isRunning() && "setOnFrameRendered() must be called before start()");
+    on_frame_rendered_ = std::move(callback);
+}
+
+void RenderThread::stop() {
+    if (!running_.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void RenderThread::setTargetFrameRate(double frames_per_second) {
+    target_fps_.store(std::max(frames_per_second, 0.0), std::memory_order_relaxed);
+}
+
+bool RenderThread::acquireFront() {
+    if (!(ready_.load(std::memory_order_acquire) & FRESH)) {
+        return false;
+    }
+    uint32_t previous = ready_.exchange(front_, std::memory_order_acq_rel);
+    front_ = previous & SLOT_MASK;
+    return true;
+}
+
+bool RenderThread::renderPending() {
+    std::lock_guard<std::mutex> lock(render_mutex_);
+    if (!acquireFront()) {
+        return false;
+    }
+    renderFront();
+    return true;
+}
+
+void RenderThread::threadLoop() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point next_frame_time = Clock::now();
+    
+    while (running_.load(std::memory_order_acquire)) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait(lock, [this]() {
+                return !running_.load(std::memory_order_acquire) ||
+                       (ready_.load(std::memory_order_acquire) & FRESH);
+            });
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        
+        // Pace: no earlier than one frame interval after the previous frame.
+        // Snapshots published while waiting replace the one that woke us.
+        double fps = target_fps_.load(std::memory_order_relaxed);
+        if (fps > 0.0) {
+            std::this_thread::sleep_until(next_frame_time);
+            auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+            next_frame_time = std::max(next_frame_time + interval, Clock::now());
+        }
+        renderPending();
+    }
+}
+
+void RenderThread::renderFront() {
+    const SceneSnapshot& snapshot = slots_[front_];
+    auto start = std::chrono::steady_clock::now();
+    
+    renderer_.beginRender();
+    if (renderer_.getViewportWidth() != snapshot.viewport_width ||
+        renderer_.getViewportHeight() != snapshot.viewport_height) {
+        renderer_.setViewport(snapshot.viewport_width, snapshot.viewport_height);
+    }
+    renderer_.clear(snapshot.clear_color[0], snapshot.clear_color[1], snapshot.clear_color[2], snapshot.clear_color[3]);
+    renderer_.setProjectionMatrix(snapshot.projection);
+    renderer_.setModelViewMatrix(snapshot.model_view);
+    
+    for (const SceneBatch& batch : snapshot.batches) {
+        commands_.setDepthTest(batch.depth_test);
+        commands_.setLighting(batch.lighting);
+        commands_.setMaterial(batch.material);
+        commands_.draw(batch.primitive, batch.vertices.data(), batch.vertices.size());
+    }
+    commands_.submit(renderer_);
+    
+    // One culling stage and pyramid per layer keep their caches across frames
+    while (culling_.size() < snapshot.point_layers.size()) {
+        culling_.push_back(std::make_unique<CullingStage>());
+        pyramids_.push_back(nullptr);
+    }
+    culling_.resize(snapshot.point_layers.size());
+    pyramids_.resize(snapshot.point_layers.size());
+    renderer_.enableDepthTest(true);
+    for (size_t i = 0; i < snapshot.point_layers.size(); ++i) {
+        const ScenePointLayer& layer = snapshot.point_layers[i];
+        if (layer.points.size() >= PYRAMID_MIN_POINTS) {
+            if (!pyramids_[i]) {
+                pyramids_[i] = std::make_unique<PointPyramid>();
+            }
+            pyramids_[i]->update(layer.points);
+            if (pyramids_[i]->isBuilt()) {
+                pyramids_[i]->setPointColor(layer.r, layer.g, layer.b, layer.a);
+                pyramids_[i]->draw(renderer_);
+                continue;
+            }
+        }
+        culling_[i]->setPointColor(layer.r, layer.g, layer.b, layer.a);
+        culling_[i]->draw(layer.points, renderer_);
+    }
+    renderer_.endRender();
+    
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.frames_rendered++;
+        stats_.last_frame_milliseconds = milliseconds;
+    }
+    if (on_frame_rendered_) {
+        on_frame_rendered_(snapshot);
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex_);
+        rendered_frame_.store(snapshot.frame, std::memory_order_release);
+    }
+    frame_cv_.notify_all();
+}
+
+bool RenderThread::waitForFrame(uint64_t frame, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    return frame_cv_.wait_for(lock, timeout, [this, frame]() {
+        return rendered_frame_.load(std::memory_order_acquire) >= frame;
+    });
+}
+
+RenderThreadStats RenderThread::getStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
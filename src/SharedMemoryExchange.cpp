@@ -0,0 +1,275 @@
+#include "../include/SharedMemoryExchange.h"
+#include "../include/Solution.h"
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(ShmBatchDescriptor) == 64, "descriptor must stay one cache line");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring needs address-free atomics");
+
+struct SharedMemoryExchange::RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    alignas(64) std::atomic<uint64_t> head;  // Consumer position
+    alignas(64) std::atomic<uint64_t> tail;  // Producer position
+};
+
+namespace {
+
+const uint32_t RING_MAGIC = 0x44534D52;  // "DSMR"
+const uint32_t RING_VERSION = 1;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::string segmentName(const std::string& name) {
+    return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+} // namespace
+
+SharedMemoryExchange::SharedMemoryExchange(const std::string& name, Role role, size_t capacity)
+    : name_(segmentName(name)), role_(role), capacity_(alignUp(capacity, RECORD_ALIGNMENT)),
+      fd_(-1), mapping_(nullptr), mapping_size_(0), header_(nullptr), ring_(nullptr),
+      pending_tail_(0), peeked_head_(0), sequence_(0) {
+}
+
+SharedMemoryExchange::~SharedMemoryExchange() {
+    close();
+}
+
+bool SharedMemoryExchange::open() {
+    if (isOpen()) {
+        return true;
+    }
+    
+    size_t header_size = alignUp(sizeof(RingHeader), RECORD_ALIGNMENT);
+    if (role_ == Role::PRODUCER) {
+        fd_ = ::shm_open(name_.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd_ < 0) {
+            return false;
+        }
+        mapping_size_ = header_size + capacity_;
+        if (::ftruncate(fd_, static_cast<off_t>(mapping_size_)) != 0) {
+            close();
+            return false;
+        }
+    } else {
+        fd_ = ::shm_open(name_.c_str(), O_RDWR, 0600);
+        if (fd_ < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd_, &info) != 0 || static_cast<size_t>(info.st_size) <= header_size) {
+            close();
+            return false;
+        }
+        mapping_size_ = static_cast<size_t>(info.st_size);
+    }
+    
+    mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        close();
+        return false;
+    }
+    
+    RingHeader* header = static_cast<RingHeader*>(mapping_);
+    if (role_ == Role::PRODUCER) {
+        header = new (mapping_) RingHeader();
+        header->capacity = capacity_;
+        header->version = RING_VERSION;
+        header->head.store(0, std::memory_order_relaxed);
+        header->tail.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = RING_MAGIC;
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->magic != RING_MAGIC || header->version != RING_VERSION ||
+            header->capacity + header_size > mapping_size_) {
+            close();
+            return false;
+        }
+        capacity_ = header->capacity;
+    }
+    
+    header_ = header;
+    ring_ = static_cast<char*>(mapping_) + header_size;
+    pending_tail_ = header_->tail.load(std::memory_order_acquire);
+    peeked_head_ = header_->head.load(std::memory_order_acquire);
+    return true;
+}
+
+void SharedMemoryExchange::close() {
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+        if (role_ == Role::PRODUCER) {
+            ::shm_unlink(name_.c_str());  // Attached consumers keep their mapping
+        }
+    }
+    header_ = nullptr;
+    ring_ = nullptr;
+}
+
+bool SharedMemoryExchange::sendBatch(BatchKind kind, const std::string& data_type, const void* data,
+                                     size_t element_size, size_t element_count) {
+    void* payload = beginBatch(kind, data_type, element_size, element_count);
+    if (!payload) {
+        return false;
+    }
+    std::memcpy(payload, data, element_size * element_count);
+    commitBatch();
+    return true;
+}
+
+void* SharedMemoryExchange::beginBatch(BatchKind kind, const std::string& data_type,
+                                       size_t element_size, size_t element_count) {
+    if (!isOpen() || role_ != Role::PRODUCER || data_type.size() >= sizeof(ShmBatchDescriptor::data_type)) {
+        return nullptr;
+    }
+    
+    size_t payload_bytes = element_size * element_count;
+    size_t record_size = sizeof(ShmBatchDescriptor) + alignUp(payload_bytes, RECORD_ALIGNMENT);
+    if (record_size > capacity_) {
+        return nullptr;
+    }
+    
+    uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    size_t offset = static_cast<size_t>(tail % capacity_);
+    size_t padding = (capacity_ - offset < record_size) ? capacity_ - offset : 0;
+    if (tail + padding + record_size - head > capacity_) {
+        return nullptr; // Ring full, the consumer has not caught up yet
+    }
+    
+    // Records never wrap, skip the unused end of the ring
+    if (padding > 0) {
+        ShmBatchDescriptor* marker = reinterpret_cast<ShmBatchDescriptor*>(ring_ + offset);
+        marker->kind = PADDING_KIND;
+        marker->payload_bytes = padding - sizeof(ShmBatchDescriptor);
+        tail += padding;
+        offset = 0;
+    }
+    
+    ShmBatchDescriptor* descriptor = reinterpret_cast<ShmBatchDescriptor*>(ring_ + offset);
+    descriptor->kind = static_cast<uint32_t>(kind);
+    descriptor->element_size = static_cast<uint32_t>(element_size);
+    descriptor->element_count = element_count;
+    descriptor->payload_bytes = payload_bytes;
+    descriptor->sequence = sequence_++;
+    std::memset(descriptor->data_type, 0, sizeof(descriptor->data_type));
+    std::memcpy(descriptor->data_type, data_type.data(), data_type.size());
+    
+    pending_tail_ = tail + record_size;
+    // Publish the padding now so the consumer can skip it while the batch is filled
+    header_->tail.store(tail, std::memory_order_release);
+    return descriptor + 1;
+}
+
+void SharedMemoryExchange::commitBatch() {
+    if (isOpen() && role_ == Role::PRODUCER) {
+        header_->tail.store(pending_tail_, std::memory_order_release);
+    }
+}
+
+bool SharedMemoryExchange::peekBatch(ShmBatchView& view) {
+    if (!isOpen() || role_ != Role::CONSUMER) {
+        return false;
+    }
+    
+    uint64_t head = header_->head.load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        if (head == tail) {
+            return false;
+        }
+        
+        const ShmBatchDescriptor* descriptor =
+            reinterpret_cast<const ShmBatchDescriptor*>(ring_ + head % capacity_);
+        if (descriptor->kind == PADDING_KIND) {
+            head += sizeof(ShmBatchDescriptor) + descriptor->payload_bytes;
+            header_->head.store(head, std::memory_order_release);
+            continue;
+        }
+        
+        view.descriptor = descriptor;
+        view.data = descriptor + 1;
+        peeked_head_ = head + sizeof(ShmBatchDescriptor) + alignUp(descriptor->payload_bytes, RECORD_ALIGNMENT);
+        return true;
+    }
+}
+
+void SharedMemoryExchange::releaseBatch() {
+    if (isOpen() && role_ == Role::CONSUMER) {
+        header_->head.store(peeked_head_, std::memory_order_release);
+    }
+}
+
+size_t SharedMemoryExchange::pump(Solution* target, size_t max_batches) {
+    if (!target) {
+        return 0;
+    }
+    
+    size_t delivered = 0;
+    ShmBatchView view;
+    while (delivered < max_batches && peekBatch(view)) {
+        const double* values = static_cast<const double*>(view.data);
+        size_t count = view.descriptor->payload_bytes / sizeof(double);
+        auto payload = std::make_shared<const std::vector<double>>(values, values + count);
+        DataTypeId type = DataTypeRegistry::registerType(view.descriptor->data_type);
+        releaseBatch();
+        
+        target->receiveBuffer(DataBuffer::make<std::vector<double>>(type, std::move(payload), count));
+        ++delivered;
+    }
+    return delivered;
+}
+
+bool SharedMemoryExchange::canProcess(const std::string& data_type) const {
+    return data_type == "points2d" || data_type == "points3d" || data_type == "mesh";
+}
+
+void* SharedMemoryExchange::processData(void* data, const std::string& data_type) {
+    // data points to a std::vector<double> of packed coordinates
+    if (!data || !canProcess(data_type)) {
+        return nullptr;
+    }
+    const auto* values = static_cast<const std::vector<double>*>(data);
+    bool sent = sendBatch(kindForDataType(data_type), data_type, values->data(), sizeof(double), values->size());
+    return sent ? data : nullptr;
+}
+
+std::vector<std::string> SharedMemoryExchange::getSupportedDataTypes() const {
+    return {"points2d", "points3d", "mesh"};
+}
+
+DataBuffer SharedMemoryExchange::processBuffer(const DataBuffer& buffer) {
+    const auto* values = buffer.as<std::vector<double>>();
+    std::string data_type = DataTypeRegistry::getTypeName(buffer.getType());
+    if (!values || !canProcess(data_type)) {
+        return DataBuffer();
+    }
+    if (!sendBatch(kindForDataType(data_type), data_type, values->data(), sizeof(double), values->size())) {
+        return DataBuffer();
+    }
+    return buffer;
+}
+
+SharedMemoryExchange::BatchKind SharedMemoryExchange::kindForDataType(const std::string& data_type) {
+    if (data_type == "points3d") {
+        return BatchKind::POINTS_3D;
+    } else if (data_type == "mesh") {
+        return BatchKind::MESH;
+    }
+    return BatchKind::POINTS_2D;
+}
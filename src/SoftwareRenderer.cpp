@@ -0,0 +1,699 @@
+#include "../include/SoftwareRenderer.h"
+#include "../include/CullingStage.h"
+#include "../include/TaskScheduler.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <fstream>
+
+namespace {
+
+// Vertices transformed per scheduler task
+const size_t TRANSFORM_GRAIN = 4096;
+
+// Side planes sit at GUARD_BAND times the viewport's extent, so clipped
+// screen coordinates stay small enough for float edge functions and int
+// casts while primitives crossing the viewport edge are rarely cut
+const float GUARD_BAND = 4.0f;
+const int CLIP_PLANES = 6;
+
+// Clip planes kept in homogeneous space: near (z >= -w), far (z <= w), then
+// the guard band's left, right, bottom and top (|x|, |y| <= GUARD_BAND * w)
+float planeDistance(const float* vertex, int plane) {
+    switch (plane) {
+        case 0: return vertex[2] + vertex[3];
+        case 1: return vertex[3] - vertex[2];
+        case 2: return vertex[0] + GUARD_BAND * vertex[3];
+        case 3: return GUARD_BAND * vertex[3] - vertex[0];
+        case 4: return vertex[1] + GUARD_BAND * vertex[3];
+        default: return GUARD_BAND * vertex[3] - vertex[1];
+    }
+}
+
+bool insideClipPlanes(const float* vertex) {
+    for (int plane = 0; plane < CLIP_PLANES; ++plane) {
+        if (planeDistance(vertex, plane) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void transformPoint(const float* m, float x, float y, float z, float w, float* out) {
+    for (int row = 0; row < 4; ++row) {
+        out[row] = m[row] * x + m[4 + row] * y + m[8 + row] * z + m[12 + row] * w;
+    }
+}
+
+uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    };
+    static const Table table;
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    appendBigEndian(out, static_cast<uint32_t>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+} // namespace
+
+SoftwareRenderer::SoftwareRenderer(int width, int height)
+    : id_enabled_(false), draw_id_(0), per_primitive_id_(false),
+      tiles_x_(0), tiles_y_(0), pending_points_(0), point_size_(1.0f) {
+    headless_ = true;
+    viewport_width_ = std::max(width, 1);
+    viewport_height_ = std::max(height, 1);
+}
+
+SoftwareRenderer::~SoftwareRenderer() {
+}
+
+bool SoftwareRenderer::initialize() {
+    if (initialized_) {
+        return true;
+    }
+    
+    headless_ = true;
+    resizeFramebuffer();
+    initialized_ = true;
+    return true;
+}
+
+void SoftwareRenderer::shutdown() {
+    OpenGLRenderer::shutdown();
+    triangles_.clear();
+    pending_points_ = 0;
+    bins_.clear();
+    color_.clear();
+    depth_.clear();
+}
+
+void SoftwareRenderer::beginRender() {
+    OpenGLRenderer::beginRender();
+}
+
+void SoftwareRenderer::endRender() {
+    flush();
+    OpenGLRenderer::endRender();
+}
+
+void SoftwareRenderer::setViewport(int width, int height) {
+    flush();
+    viewport_width_ = std::max(width, 1);
+    viewport_height_ = std::max(height, 1);
+    resizeFramebuffer();
+}
+
+void SoftwareRenderer::resizeFramebuffer() {
+    size_t pixels = static_cast<size_t>(viewport_width_) * viewport_height_;
+    color_.assign(pixels, packColor(0.0f, 0.0f, 0.0f, 1.0f));
+    depth_.assign(pixels, 1.0f);
+    if (id_enabled_) {
+        ids_.assign(pixels, 0);
+    }
+    tiles_x_ = (viewport_width_ + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y_ = (viewport_height_ + TILE_SIZE - 1) / TILE_SIZE;
+    bins_.assign(static_cast<size_t>(tiles_x_) * tiles_y_, std::vector<BinEntry>());
+}
+
+void SoftwareRenderer::clear(float r, float g, float b, float a) {
+    if (color_.empty()) {
+        resizeFramebuffer();
+    }
+    triangles_.clear();
+    pending_points_ = 0;
+    for (std::vector<BinEntry>& bin : bins_) {
+        bin.clear();
+    }
+    std::fill(color_.begin(), color_.end(), packColor(r, g, b, a));
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+    std::fill(ids_.begin(), ids_.end(), 0);
+}
+
+void SoftwareRenderer::enableIdBuffer(bool enable) {
+    flush();
+    id_enabled_ = enable;
+    if (enable) {
+        ids_.assign(color_.size(), 0);
+    } else {
+        ids_.clear();
+    }
+}
+
+void SoftwareRenderer::setDrawId(uint32_t first_id, bool per_primitive) {
+    draw_id_ = first_id;
+    per_primitive_id_ = per_primitive;
+}
+
+bool SoftwareRenderer::readIdBuffer(int x, int y, int width, int height, std::vector<uint32_t>& ids) {
+    flush();
+    ids.clear();
+    if (!id_enabled_ || ids_.empty()) {
+        return false;
+    }
+    
+    // Clamp to the viewport, rows of the clamped rectangle are packed
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + width, viewport_width_);
+    int y1 = std::min(y + height, viewport_height_);
+    for (int row = y0; row < y1; ++row) {
+        const uint32_t* begin = ids_.data() + static_cast<size_t>(row) * viewport_width_;
+        ids.insert(ids.end(), begin + x0, begin + std::max(x0, x1));
+    }
+    return true;
+}
+
+void SoftwareRenderer::drawTriangles(const std::vector<Vertex3D>& vertices) {
+    submit(PrimitiveType::TRIANGLES, vertices);
+}
+
+void SoftwareRenderer::drawLines(const std::vector<Vertex3D>& vertices) {
+    submit(PrimitiveType::LINES, vertices);
+}
+
+void SoftwareRenderer::drawPoints(const std::vector<Vertex3D>& vertices) {
+    submit(PrimitiveType::POINTS, vertices);
+}
+
+void SoftwareRenderer::drawBuffer(BufferHandle handle, PrimitiveType primitive, size_t first_vertex, size_t count) {
+    if (readBuffer(handle, first_vertex, count, buffer_vertices_)) {
+        submit(primitive, buffer_vertices_);
+    }
+}
+
+void SoftwareRenderer::submit(PrimitiveType primitive, const std::vector<Vertex3D>& vertices) {
+    if (vertices.empty()) {
+        return;
+    }
+    if (color_.empty()) {
+        resizeFramebuffer();
+    }
+    RenderStageTimer timer(render_stats_, RenderStage::GEOMETRY);
+    drawArrays(primitive, vertices.size());
+    transformVertices(vertices);
+    
+    // Assembly and binning stay serial so bins keep submission order
+    auto primitiveId = [this](size_t index) {
+        return per_primitive_id_ ? draw_id_ + static_cast<uint32_t>(index) : draw_id_;
+    };
+    switch (primitive) {
+        case PrimitiveType::TRIANGLES:
+            for (size_t i = 0; i + 2 < clip_.size(); i += 3) {
+                addTriangle(clip_[i], clip_[i + 1], clip_[i + 2], primitiveId(i / 3));
+            }
+            break;
+        case PrimitiveType::LINES:
+            for (size_t i = 0; i + 1 < clip_.size(); i += 2) {
+                addLine(clip_[i], clip_[i + 1], primitiveId(i / 2));
+            }
+            break;
+        case PrimitiveType::POINTS:
+            for (size_t i = 0; i < clip_.size(); ++i) {
+                addPoint(clip_[i], primitiveId(i));
+            }
+            break;
+    }
+}
+
+void SoftwareRenderer::transformVertices(const std::vector<Vertex3D>& vertices) {
+    // Combined matrix once per draw call
+    ClipTransform transform(projection_, model_view_);
+    const float* mvp = transform.mvp;
+    
+    clip_.resize(vertices.size());
+    bool lighting = lighting_;
+    TaskScheduler::current().parallelFor(0, vertices.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Vertex3D& vertex = vertices[i];
+            ClipVertex& out = clip_[i];
+            float position[4];
+            transformPoint(mvp, vertex.x, vertex.y, vertex.z, 1.0f, position);
+            out.x = position[0];
+            out.y = position[1];
+            out.z = position[2];
+            out.w = position[3];
+            out.r = vertex.r;
+            out.g = vertex.g;
+            out.b = vertex.b;
+            out.a = vertex.a;
+            
+            // Two-sided headlight in eye space, like the fixed-function default
+            if (lighting && (vertex.nx != 0.0f || vertex.ny != 0.0f || vertex.nz != 0.0f)) {
+                float normal[4];
+                transformPoint(model_view_, vertex.nx, vertex.ny, vertex.nz, 0.0f, normal);
+                float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                float diffuse = length > 0.0f ? std::fabs(normal[2]) / length : 0.0f;
+                float shade = 0.25f + 0.75f * diffuse;
+                out.r *= shade;
+                out.g *= shade;
+                out.b *= shade;
+            }
+        }
+    }, TRANSFORM_GRAIN);
+}
+
+SoftwareRenderer::ScreenVertex SoftwareRenderer::toScreen(const ClipVertex& vertex) const {
+    float inverse_w = 1.0f / vertex.w;
+    ScreenVertex out;
+    out.x = (vertex.x * inverse_w * 0.5f + 0.5f) * viewport_width_;
+    out.y = (0.5f - vertex.y * inverse_w * 0.5f) * viewport_height_;
+    out.z = vertex.z * inverse_w * 0.5f + 0.5f;
+    out.r = vertex.r;
+    out.g = vertex.g;
+    out.b = vertex.b;
+    out.a = vertex.a;
+    return out;
+}
+
+void SoftwareRenderer::addTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, uint32_t id) {
+    // Trivial reject against the side planes before clipping
+    const ClipVertex* input[3] = {&a, &b, &c};
+    for (int axis = 0; axis < 2; ++axis) {
+        int below = 0;
+        int above = 0;
+        for (const ClipVertex* vertex : input) {
+            float value = axis == 0 ? vertex->x : vertex->y;
+            below += value < -vertex->w;
+            above += value > vertex->w;
+        }
+        if (below == 3 || above == 3) {
+            return;
+        }
+    }
+    
+    Triangle triangle;
+    triangle.id = id;
+    triangle.depth_test = depth_test_;
+    bool inside = true;
+    for (const ClipVertex* vertex : input) {
+        inside = inside && insideClipPlanes(&vertex->x);
+    }
+    if (inside) {
+        triangle.v[0] = toScreen(a);
+        triangle.v[1] = toScreen(b);
+        triangle.v[2] = toScreen(c);
+        binScreenTriangle(triangle);
+        return;
+    }
+    
+    // Sutherland-Hodgman against every plane, each can add one vertex
+    ClipVertex polygon[3 + CLIP_PLANES] = {a, b, c};
+    int count = 3;
+    for (int plane = 0; plane < CLIP_PLANES; ++plane) {
+        ClipVertex clipped[3 + CLIP_PLANES];
+        int clipped_count = 0;
+        for (int i = 0; i < count; ++i) {
+            const ClipVertex& current = polygon[i];
+            const ClipVertex& next = polygon[(i + 1) % count];
+            float d0 = planeDistance(&current.x, plane);
+            float d1 = planeDistance(&next.x, plane);
+            if (d0 >= 0.0f) {
+                clipped[clipped_count++] = current;
+            }
+            if ((d0 >= 0.0f) != (d1 >= 0.0f)) {
+                float t = d0 / (d0 - d1);
+                const float* from = &current.x;
+                const float* to = &next.x;
+                float* out = &clipped[clipped_count++].x;
+                for (int k = 0; k < 8; ++k) {
+                    out[k] = from[k] + (to[k] - from[k]) * t;
+                }
+            }
+        }
+        count = clipped_count;
+        if (count < 3) {
+            return;
+        }
+        std::copy(clipped, clipped + count, polygon);
+    }
+    
+    triangle.v[0] = toScreen(polygon[0]);
+    for (int i = 1; i + 1 < count; ++i) {
+        triangle.v[1] = toScreen(polygon[i]);
+        triangle.v[2] = toScreen(polygon[i + 1]);
+        binScreenTriangle(triangle);
+    }
+}
+
+void SoftwareRenderer::addLine(const ClipVertex& a, const ClipVertex& b, uint32_t id) {
+    ClipVertex ends[2] = {a, b};
+    for (int plane = 0; plane < CLIP_PLANES; ++plane) {
+        float d0 = planeDistance(&ends[0].x, plane);
+        float d1 = planeDistance(&ends[1].x, plane);
+        if (d0 < 0.0f && d1 < 0.0f) {
+            return;
+        }
+        if (d0 < 0.0f || d1 < 0.0f) {
+            float t = d0 / (d0 - d1);
+            ClipVertex cut;
+            float* out = &cut.x;
+            for (int k = 0; k < 8; ++k) {
+                out[k] = (&ends[0].x)[k] + ((&ends[1].x)[k] - (&ends[0].x)[k]) * t;
+            }
+            ends[d0 < 0.0f ? 0 : 1] = cut;
+        }
+    }
+    
+    // One pixel wide quad around the projected segment
+    ScreenVertex s0 = toScreen(ends[0]);
+    ScreenVertex s1 = toScreen(ends[1]);
+    float dx = s1.x - s0.x;
+    float dy = s1.y - s0.y;
+    float length = std::sqrt(dx * dx + dy * dy);
+    if (length == 0.0f) {
+        return;
+    }
+    float ox = -dy / length * 0.5f;
+    float oy = dx / length * 0.5f;
+    
+    Triangle triangle;
+    triangle.id = id;
+    triangle.depth_test = depth_test_;
+    ScreenVertex corners[4] = {s0, s0, s1, s1};
+    corners[0].x += ox; corners[0].y += oy;
+    corners[1].x -= ox; corners[1].y -= oy;
+    corners[2].x -= ox; corners[2].y -= oy;
+    corners[3].x += ox; corners[3].y += oy;
+    triangle.v[0] = corners[0];
+    triangle.v[1] = corners[1];
+    triangle.v[2] = corners[2];
+    binScreenTriangle(triangle);
+    triangle.v[1] = corners[2];
+    triangle.v[2] = corners[3];
+    binScreenTriangle(triangle);
+}
+
+void SoftwareRenderer::addPoint(const ClipVertex& vertex, uint32_t id) {
+    if (!insideClipPlanes(&vertex.x)) {
+        return;
+    }
+    ScreenVertex screen = toScreen(vertex);
+    int size = static_cast<int>(point_size_);
+    int x0 = static_cast<int>(std::floor(screen.x - point_size_ * 0.5f + 0.5f));
+    int y0 = static_cast<int>(std::floor(screen.y - point_size_ * 0.5f + 0.5f));
+    int x1 = std::min(x0 + size, viewport_width_);
+    int y1 = std::min(y0 + size, viewport_height_);
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    
+    uint32_t flags = PIXEL_ENTRY | (depth_test_ ? DEPTH_TESTED : 0);
+    uint32_t color = packColor(screen.r, screen.g, screen.b, screen.a);
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            uint32_t offset = static_cast<uint32_t>(y) * viewport_width_ + x;
+            bins_[static_cast<size_t>(y / TILE_SIZE) * tiles_x_ + x / TILE_SIZE].push_back(BinEntry{flags | offset, screen.z, color, id});
+        }
+    }
+    pending_points_++;
+}
+
+void SoftwareRenderer::binScreenTriangle(const Triangle& triangle) {
+    const ScreenVertex* v = triangle.v;
+    float min_x = std::min({v[0].x, v[1].x, v[2].x});
+    float max_x = std::max({v[0].x, v[1].x, v[2].x});
+    float min_y = std::min({v[0].y, v[1].y, v[2].y});
+    float max_y = std::max({v[0].y, v[1].y, v[2].y});
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= viewport_width_ || min_y >= viewport_height_) {
+        return;
+    }
+    
+    uint32_t index = static_cast<uint32_t>(triangles_.size());
+    triangles_.push_back(triangle);
+    // Clamp in float, the cast of an out-of-range value is undefined
+    int tile_x0 = static_cast<int>(std::max(min_x, 0.0f)) / TILE_SIZE;
+    int tile_y0 = static_cast<int>(std::max(min_y, 0.0f)) / TILE_SIZE;
+    int tile_x1 = static_cast<int>(std::min(max_x, static_cast<float>(viewport_width_ - 1))) / TILE_SIZE;
+    int tile_y1 = static_cast<int>(std::min(max_y, static_cast<float>(viewport_height_ - 1))) / TILE_SIZE;
+    for (int ty = tile_y0; ty <= tile_y1; ++ty) {
+        for (int tx = tile_x0; tx <= tile_x1; ++tx) {
+            bins_[static_cast<size_t>(ty) * tiles_x_ + tx].push_back(BinEntry{index, 0.0f, 0, 0});
+        }
+    }
+}
+
+void SoftwareRenderer::flush() {
+    if (triangles_.empty() && pending_points_ == 0) {
+        return;
+    }
+    
+    RenderStageTimer timer(render_stats_, RenderStage::RASTER);
+    TaskScheduler::current().parallelFor(0, bins_.size(), [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            rasterizeTile(tile);
+        }
+    }, 1);
+    
+    triangles_.clear();
+    pending_points_ = 0;
+    for (std::vector<BinEntry>& bin : bins_) {
+        bin.clear();
+    }
+}
+
+void SoftwareRenderer::rasterizeTile(size_t tile) {
+    int x0 = static_cast<int>(tile % tiles_x_) * TILE_SIZE;
+    int y0 = static_cast<int>(tile / tiles_x_) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, viewport_width_);
+    int y1 = std::min(y0 + TILE_SIZE, viewport_height_);
+    for (const BinEntry& entry : bins_[tile]) {
+        if (!(entry.primitive & PIXEL_ENTRY)) {
+            rasterizeTriangle(triangles_[entry.primitive], x0, y0, x1, y1);
+            continue;
+        }
+        size_t pixel = entry.primitive & OFFSET_MASK;
+        if (entry.primitive & DEPTH_TESTED) {
+            if (entry.z >= depth_[pixel]) {
+                continue;
+            }
+            depth_[pixel] = entry.z;
+        }
+        color_[pixel] = entry.color;
+        if (id_enabled_) {
+            ids_[pixel] = entry.id;
+        }
+    }
+}
+
+void SoftwareRenderer::rasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1) {
+    const ScreenVertex* v[3] = {&triangle.v[0], &triangle.v[1], &triangle.v[2]};
+    float area = (v[1]->x - v[0]->x) * (v[2]->y - v[0]->y) - (v[1]->y - v[0]->y) * (v[2]->x - v[0]->x);
+    if (area == 0.0f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+    
+    // Edge function of the edge opposite vertex i: e = a * x + b * y + c,
+    // positive inside, stepping one pixel in x adds a
+    float a[3], b[3], c[3];
+    for (int i = 0; i < 3; ++i) {
+        const ScreenVertex* from = v[(i + 1) % 3];
+        const ScreenVertex* to = v[(i + 2) % 3];
+        a[i] = from->y - to->y;
+        b[i] = to->x - from->x;
+        c[i] = from->x * to->y - from->y * to->x;
+    }
+    
+    // Top-left rule: a pixel center exactly on an edge is only covered by a
+    // left edge (inside to its right) or a top edge (horizontal, inside below),
+    // so an edge shared by two triangles is drawn once. Other edges need
+    // e > 0, i.e. at least the smallest positive float.
+    float bias[3];
+    for (int i = 0; i < 3; ++i) {
+        bool top_left = a[i] > 0.0f || (a[i] == 0.0f && b[i] > 0.0f);
+        bias[i] = top_left ? 0.0f : std::numeric_limits<float>::min();
+    }
+    
+    // Bounds clamped to the tile in float before the cast
+    int min_x = static_cast<int>(std::floor(std::max(static_cast<float>(x0), std::min({v[0]->x, v[1]->x, v[2]->x}))));
+    int max_x = static_cast<int>(std::ceil(std::min(static_cast<float>(x1 - 1), std::max({v[0]->x, v[1]->x, v[2]->x}))));
+    int min_y = static_cast<int>(std::floor(std::max(static_cast<float>(y0), std::min({v[0]->y, v[1]->y, v[2]->y}))));
+    int max_y = static_cast<int>(std::ceil(std::min(static_cast<float>(y1 - 1), std::max({v[0]->y, v[1]->y, v[2]->y}))));
+    if (min_x > max_x || min_y > max_y) {
+        return;
+    }
+    
+    // Attributes as planes over the pixel grid: value = base + dx * x + dy * y
+    float inverse_area = 1.0f / area;
+    float planes[5][3];
+    const float* attributes[3] = {&v[0]->z, &v[1]->z, &v[2]->z};
+    for (int k = 0; k < 5; ++k) {
+        planes[k][0] = planes[k][1] = planes[k][2] = 0.0f;
+        for (int i = 0; i < 3; ++i) {
+            float value = attributes[i][k] * inverse_area;
+            planes[k][0] += a[i] * value;
+            planes[k][1] += b[i] * value;
+            planes[k][2] += c[i] * value;
+        }
+    }
+    
+    bool depth_test = triangle.depth_test;
+    int width = viewport_width_;
+    for (int y = min_y; y <= max_y; ++y) {
+        float py = y + 0.5f;
+        float row[3];
+        for (int i = 0; i < 3; ++i) {
+            row[i] = b[i] * py + c[i];
+        }
+        
+        // Four pixels per step; the fixed-width lanes vectorize
+        for (int x = min_x; x <= max_x; x += 4) {
+            bool inside[4];
+            float px[4];
+            for (int lane = 0; lane < 4; ++lane) {
+                px[lane] = x + lane + 0.5f;
+                float e0 = a[0] * px[lane] + row[0];
+                float e1 = a[1] * px[lane] + row[1];
+                float e2 = a[2] * px[lane] + row[2];
+                inside[lane] = e0 >= bias[0] && e1 >= bias[1] && e2 >= bias[2] && x + lane <= max_x;
+            }
+            for (int lane = 0; lane < 4; ++lane) {
+                if (!inside[lane]) {
+                    continue;
+                }
+                size_t pixel = static_cast<size_t>(y) * width + x + lane;
+                float z = planes[0][0] * px[lane] + planes[0][1] * py + planes[0][2];
+                if (depth_test) {
+                    if (z >= depth_[pixel]) {
+                        continue;
+                    }
+                    depth_[pixel] = z;
+                }
+                color_[pixel] = packColor(planes[1][0] * px[lane] + planes[1][1] * py + planes[1][2],
+                                          planes[2][0] * px[lane] + planes[2][1] * py + planes[2][2],
+                                          planes[3][0] * px[lane] + planes[3][1] * py + planes[3][2],
+                                          planes[4][0] * px[lane] + planes[4][1] * py + planes[4][2]);
+                if (id_enabled_) {
+                    ids_[pixel] = triangle.id;
+                }
+            }
+        }
+    }
+}
+
+const std::vector<uint32_t>& SoftwareRenderer::getColorBuffer() {
+    flush();
+    return color_;
+}
+
+uint32_t SoftwareRenderer::getPixel(int x, int y) {
+    flush();
+    if (x < 0 || y < 0 || x >= viewport_width_ || y >= viewport_height_ || color_.empty()) {
+        return 0;
+    }
+    return color_[static_cast<size_t>(y) * viewport_width_ + x];
+}
+
+float SoftwareRenderer::getDepth(int x, int y) {
+    flush();
+    if (x < 0 || y < 0 || x >= viewport_width_ || y >= viewport_height_ || depth_.empty()) {
+        return 1.0f;
+    }
+    return depth_[static_cast<size_t>(y) * viewport_width_ + x];
+}
+
+bool SoftwareRenderer::writePPM(const std::string& path) {
+    const std::vector<uint32_t>& pixels = getColorBuffer();
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    
+    file << "P6\n" << viewport_width_ << " " << viewport_height_ << "\n255\n";
+    std::vector<char> row(static_cast<size_t>(viewport_width_) * 3);
+    for (int y = 0; y < viewport_height_; ++y) {
+        for (int x = 0; x < viewport_width_; ++x) {
+            const uint8_t* rgba = reinterpret_cast<const uint8_t*>(&pixels[static_cast<size_t>(y) * viewport_width_ + x]);
+            row[x * 3] = static_cast<char>(rgba[0]);
+            row[x * 3 + 1] = static_cast<char>(rgba[1]);
+            row[x * 3 + 2] = static_cast<char>(rgba[2]);
+        }
+        file.write(row.data(), row.size());
+    }
+    return static_cast<bool>(file);
+}
+
+bool SoftwareRenderer::writePNG(const std::string& path) {
+    const std::vector<uint32_t>& pixels = getColorBuffer();
+    
+    // Scanlines with filter type 0, stored in uncompressed deflate blocks
+    // so no zlib is needed
+    size_t row_bytes = static_cast<size_t>(viewport_width_) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((row_bytes + 1) * viewport_height_);
+    for (int y = 0; y < viewport_height_; ++y) {
+        raw.push_back(0);
+        const uint8_t* row = reinterpret_cast<const uint8_t*>(&pixels[static_cast<size_t>(y) * viewport_width_]);
+        raw.insert(raw.end(), row, row + row_bytes);
+    }
+    
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+    for (uint8_t byte : raw) {
+        adler_a = (adler_a + byte) % 65521;
+        adler_b = (adler_b + adler_a) % 65521;
+    }
+    size_t offset = 0;
+    do {
+        size_t block = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + block == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(block));
+        zlib.push_back(static_cast<uint8_t>(block >> 8));
+        zlib.push_back(static_cast<uint8_t>(~block));
+        zlib.push_back(static_cast<uint8_t>(~block >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + block);
+        offset += block;
+    } while (offset < raw.size());
+    appendBigEndian(zlib, (adler_b << 16) | adler_a);
+    
+    std::vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(viewport_width_));
+    appendBigEndian(header, static_cast<uint32_t>(viewport_height_));
+    header.insert(header.end(), {8, 6, 0, 0, 0});  // 8 bit RGBA, no interlace
+    
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", std::vector<uint8_t>());
+    
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(png.data()), png.size());
+    return static_cast<bool>(file);
+}
@@ -1,12 +1,29 @@
 #include "../include/Solution.h"
+#include "../include/RenderThread.h"
+#include "../include/SolutionDocument.h"
 #include <algorithm>
 #include <sstream>
 #include <cctype>
+#include <cassert>
 
-Solution::Solution() : name_("Solution") {
+Solution::Solution() : name_("Solution"), viewport_width_(800), viewport_height_(600), document_(nullptr) {
 }
 
 Solution::~Solution() {
+    stopRenderThread();
+    // The worker may be inside the derived part that is already gone
+    assert((!inbox_ || !inbox_->isRunning()) && "stopInbox() must be called before destroying the solution");
+    if (inbox_) {
+        inbox_->stop(false);
+    }
+}
+
+void Solution::setName(const std::string& name) {
+    name_ = name;
+    construction_history_.renameJournalStream(name);
+    if (document_) {
+        document_->solutionRenamed();
+    }
 }
 
 void Solution::addConstructionStep(const std::string& operation, void* data) {
@@ -117,17 +134,64 @@ void Solution::initializeRenderer() {
     if (!renderer_) {
         renderer_ = std::make_unique<OpenGLRenderer>();
         renderer_->initialize();
+        renderer_->setViewport(viewport_width_, viewport_height_);
+    }
+}
+
+void Solution::setRenderer(std::unique_ptr<OpenGLRenderer> renderer) {
+    stopRenderThread();
+    renderer_ = std::move(renderer);
+    if (renderer_ && !renderer_->isInitialized()) {
+        renderer_->initialize();
+    }
+    if (renderer_) {
+        // A backend of a given size, e.g. an offscreen one, sets the viewport
+        viewport_width_ = renderer_->getViewportWidth();
+        viewport_height_ = renderer_->getViewportHeight();
     }
 }
 
+void Solution::setViewport(int width, int height) {
+    viewport_width_ = width;
+    viewport_height_ = height;
+}
+
 void Solution::render() {
+    if (render_thread_ && render_thread_->isRunning()) {
+        SceneSnapshot& snapshot = render_thread_->beginSnapshot();
+        snapshot.viewport_width = viewport_width_;
+        snapshot.viewport_height = viewport_height_;
+        snapshot.clear_color[0] = snapshot.clear_color[1] = snapshot.clear_color[2] = 0.2f;
+        render_thread_->publish();
+        return;
+    }
     if (renderer_ && renderer_->isInitialized()) {
         renderer_->beginRender();
+        if (renderer_->getViewportWidth() != viewport_width_ || renderer_->getViewportHeight() != viewport_height_) {
+            renderer_->setViewport(viewport_width_, viewport_height_);
+        }
         renderer_->clear(0.2f, 0.2f, 0.2f, 1.0f);
         renderer_->endRender();
     }
 }
 
+RenderThread* Solution::startRenderThread(double frames_per_second) {
+    initializeRenderer();
+    if (!render_thread_) {
+        render_thread_ = std::make_unique<RenderThread>(*renderer_);
+    }
+    render_thread_->setTargetFrameRate(frames_per_second);
+    render_thread_->start();
+    return render_thread_.get();
+}
+
+void Solution::stopRenderThread() {
+    if (render_thread_) {
+        render_thread_->stop();
+        render_thread_.reset();
+    }
+}
+
 bool Solution::canReceiveData(const std::string& data_type) const {
     return canProcessDataType(data_type);
 }
@@ -157,6 +221,80 @@ void* Solution::exchangeDataWith(Solution* other_solution, const std::string& da
     return other_solution->receiveData(processed, data_type);
 }
 
+void Solution::declareDataType(DataTypeId type, bool can_send, bool can_receive) {
+    if (type == DataTypeRegistry::INVALID_TYPE) {
+        return;
+    }
+    if (type >= buffer_capabilities_.size()) {
+        buffer_capabilities_.resize(type + 1, 0);
+    }
+    buffer_capabilities_[type] = (can_send ? CAN_SEND : 0) | (can_receive ? CAN_RECEIVE : 0);
+}
+
+DataBuffer Solution::sendBuffer(DataTypeId type) {
+    if (!canSendBuffer(type)) {
+        return DataBuffer();
+    }
+    return prepareOutgoingBuffer(type);
+}
+
+DataBuffer Solution::receiveBuffer(const DataBuffer& buffer) {
+    // A registered DataExchange takes precedence over the solution's own handler
+    DataExchange* exchange = findDataExchange(buffer.getType());
+    if (exchange) {
+        return exchange->processBuffer(buffer);
+    }
+    return processIncomingBuffer(buffer);
+}
+
+DataBuffer Solution::exchangeBufferWith(Solution* other_solution, DataTypeId type) {
+    if (!other_solution || !canSendBuffer(type) || !other_solution->canReceiveBuffer(type)) {
+        return DataBuffer();
+    }
+    DataBuffer buffer = prepareOutgoingBuffer(type);
+    if (!buffer.isValid()) {
+        return DataBuffer();
+    }
+    return other_solution->receiveBuffer(buffer);
+}
+
+SolutionInbox* Solution::enableInbox(size_t capacity) {
+    if (!inbox_) {
+        inbox_ = std::make_unique<SolutionInbox>(this, capacity);
+    }
+    return inbox_.get();
+}
+
+void Solution::startInbox() {
+    enableInbox()->start();
+}
+
+void Solution::stopInbox() {
+    if (inbox_) {
+        inbox_->stop();
+    }
+}
+
+std::future<DataBuffer> Solution::postBuffer(const DataBuffer& buffer) {
+    if (inbox_) {
+        return inbox_->post(buffer);
+    }
+    
+    // No inbox: process synchronously and hand back a ready future
+    std::promise<DataBuffer> reply;
+    reply.set_value(receiveBuffer(buffer));
+    return reply.get_future();
+}
+
+std::future<DataBuffer> Solution::exchangeBufferAsync(Solution* other_solution, DataTypeId type) {
+    if (!other_solution || !canSendBuffer(type) || !other_solution->canReceiveBuffer(type)) {
+        std::promise<DataBuffer> reply;
+        reply.set_value(DataBuffer());
+        return reply.get_future();
+    }
+    return other_solution->postBuffer(prepareOutgoingBuffer(type));
+}
+
 bool Solution::canProcessDataType(const std::string& data_type) const {
     return false; // Override in derived classes
 }
@@ -169,6 +307,14 @@ void* Solution::prepareOutgoingData(const std::string& data_type) {
     return nullptr; // Override in derived classes
 }
 
+DataBuffer Solution::prepareOutgoingBuffer(DataTypeId /*type*/) {
+    return DataBuffer(); // Override in derived classes
+}
+
+DataBuffer Solution::processIncomingBuffer(const DataBuffer& buffer) {
+    return buffer; // Override in derived classes
+}
+
 std::string Solution::processTerminalCommand(const std::string& command) {
     std::stringstream result;
     std::string cmd = command;
@@ -180,8 +326,11 @@ std::string Solution::processTerminalCommand(const std::string& command) {
         result << "  status - Show solution status\n";
         result << "  nodes - List all nodes\n";
         result << "  history - Show construction history\n";
+        result << "  branches - List construction history branches\n";
         result << "  clear - Clear terminal\n";
         result << "  name - Show solution name\n";
+        result << "  renderstats - Show frame timing and render counters\n";
+        result << "  renderstats reset - Reset render statistics\n";
     } else if (cmd == "status") {
         result << "Solution: " << name_ << "\n";
         result << "Nodes: " << nodes_.size() << "\n";
@@ -210,8 +359,23 @@ std::string Solution::processTerminalCommand(const std::string& command) {
                 }
             }
         }
+    } else if (cmd == "branches") {
+        result << "History branches:\n";
+        for (const auto& branch : construction_history_.getBranchNames()) {
+            result << (branch == construction_history_.getCurrentBranch() ? "  * " : "    ")
+                   << branch << " (" << construction_history_.getBranchStepCount(branch) << " steps)\n";
+        }
     } else if (cmd == "name") {
         result << "Solution name: " << name_ << "\n";
+    } else if (cmd == "renderstats" || cmd == "renderstats reset") {
+        if (!renderer_) {
+            result << "Renderer not initialized.\n";
+        } else if (cmd == "renderstats reset") {
+            renderer_->getRenderStats().reset();
+            result << "Render statistics reset.\n";
+        } else {
+            result << renderer_->getRenderStats().format();
+        }
     } else if (cmd.empty()) {
         // Empty command, do nothing
     } else {
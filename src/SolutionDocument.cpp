@@ -1,17 +1,34 @@
 #include "../include/SolutionDocument.h"
 #include <algorithm>
+#include <unordered_map>
+#include <chrono>
 
 SolutionDocument::SolutionDocument()
-    : name_("Untitled"), path_(""), modified_(false), author_(""), description_(""), version_("1.0") {
+    : name_("Untitled"), path_(""), modified_(false), author_(""), description_(""), version_("1.0"),
+      journal_recovered_(false), name_index_valid_(false) {
 }
 
-void SolutionDocument::addSolution(std::unique_ptr<Solution> solution) {
-    if (solution) {
-        solutions_.push_back(std::move(solution));
-        modified_ = true;
+SolutionDocument::~SolutionDocument() {
+    // Inbox workers call into the derived solutions, stop them first
+    for (const auto& solution : solutions_) {
+        solution->stopInbox();
     }
 }
 
+SolutionHandle SolutionDocument::addSolution(std::unique_ptr<Solution> solution) {
+    if (!solution) {
+        return SolutionHandle();
+    }
+    syncHandles();
+    solutions_.push_back(std::move(solution));
+    modified_ = true;
+    syncHandles();
+    if (journal_recovered_) {
+        attachJournal(*solutions_.back());
+    }
+    return getHandle(solutions_.size() - 1);
+}
+
 Solution* SolutionDocument::getSolution(size_t index) const {
     if (index < solutions_.size()) {
         return solutions_[index].get();
@@ -20,37 +37,162 @@ Solution* SolutionDocument::getSolution(size_t index) const {
 }
 
 Solution* SolutionDocument::getSolution(const std::string& name) const {
-    for (const auto& solution : solutions_) {
-        if (solution->getName() == name) {
-            return solution.get();
-        }
+    return getSolution(findSolution(name));
+}
+
+Solution* SolutionDocument::getSolution(SolutionHandle handle) const {
+    if (handle.index >= slots_.size() || slots_[handle.index].generation != handle.generation) {
+        return nullptr;
     }
-    return nullptr;
+    uint32_t position = slots_[handle.index].position;
+    return position < solutions_.size() ? solutions_[position].get() : nullptr;
 }
 
 void SolutionDocument::removeSolution(size_t index) {
+    syncHandles();
     if (index < solutions_.size()) {
-        solutions_.erase(solutions_.begin() + index);
+        removeAt(index);
         modified_ = true;
     }
 }
 
 void SolutionDocument::removeSolution(const std::string& name) {
-    solutions_.erase(
-        std::remove_if(solutions_.begin(), solutions_.end(),
-            [&name](const std::unique_ptr<Solution>& solution) {
-                return solution->getName() == name;
-            }),
-        solutions_.end()
-    );
+    // Every solution with that name, as before
+    for (SolutionHandle handle = findSolution(name); handle.isValid(); handle = findSolution(name)) {
+        removeSolution(handle);
+    }
     modified_ = true;
 }
 
+bool SolutionDocument::removeSolution(SolutionHandle handle) {
+    if (!isValid(handle)) {
+        return false;
+    }
+    syncHandles();
+    removeAt(slots_[handle.index].position);
+    modified_ = true;
+    return true;
+}
+
 void SolutionDocument::clearSolutions() {
+    for (const auto& solution : solutions_) {
+        solution->stopInbox();
+    }
     solutions_.clear();
+    syncHandles();
     modified_ = true;
 }
 
+SolutionHandle SolutionDocument::getHandle(size_t index) const {
+    syncHandles();
+    if (index >= solutions_.size()) {
+        return SolutionHandle();
+    }
+    SolutionHandle handle;
+    handle.index = position_slots_[index];
+    handle.generation = slots_[handle.index].generation;
+    return handle;
+}
+
+SolutionHandle SolutionDocument::findSolution(const std::string& name) const {
+    refreshNameIndex();
+    auto it = name_index_.find(name);
+    return it != name_index_.end() ? it->second.handle : SolutionHandle();
+}
+
+bool SolutionDocument::isValid(SolutionHandle handle) const {
+    return getSolution(handle) != nullptr;
+}
+
+void SolutionDocument::syncHandles() const {
+    if (position_slots_.size() > solutions_.size()) {
+        // solutions_ shrank behind our back, retire every handle
+        for (uint32_t slot : position_slots_) {
+            ++slots_[slot].generation;
+            slots_[slot].position = SolutionHandle::INVALID_INDEX;
+            free_slots_.push_back(slot);
+        }
+        position_slots_.clear();
+        name_index_.clear();
+        name_index_valid_ = false;
+    }
+    
+    bool index_current = name_index_valid_;
+    while (position_slots_.size() < solutions_.size()) {
+        uint32_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        } else {
+            slot = static_cast<uint32_t>(slots_.size());
+            slots_.push_back(HandleSlot{0, 0});
+        }
+        uint32_t position = static_cast<uint32_t>(position_slots_.size());
+        slots_[slot].position = position;
+        position_slots_.push_back(slot);
+        solutions_[position]->document_ = this;
+        
+        if (index_current) {
+            SolutionHandle handle;
+            handle.index = slot;
+            handle.generation = slots_[slot].generation;
+            auto inserted = name_index_.emplace(solutions_[position]->getName(), NameEntry{handle, 0});
+            ++inserted.first->second.count;
+        }
+    }
+}
+
+void SolutionDocument::removeAt(size_t position) {
+    uint32_t slot = position_slots_[position];
+    solutions_[position]->stopInbox();
+    
+    solutions_[position]->document_ = nullptr;
+    
+    // Keep the name index current unless it is due for a rebuild anyway
+    if (name_index_valid_) {
+        auto it = name_index_.find(solutions_[position]->getName());
+        if (it != name_index_.end()) {
+            if (--it->second.count == 0) {
+                name_index_.erase(it);
+            } else if (it->second.handle.index == slot) {
+                name_index_valid_ = false; // A duplicate takes over the name
+            }
+        }
+    }
+    
+    ++slots_[slot].generation;
+    slots_[slot].position = SolutionHandle::INVALID_INDEX;
+    free_slots_.push_back(slot);
+    
+    // Swap-and-pop, the last solution moves into the freed position
+    size_t last = solutions_.size() - 1;
+    if (position != last) {
+        solutions_[position] = std::move(solutions_[last]);
+        position_slots_[position] = position_slots_[last];
+        slots_[position_slots_[position]].position = static_cast<uint32_t>(position);
+    }
+    solutions_.pop_back();
+    position_slots_.pop_back();
+}
+
+void SolutionDocument::refreshNameIndex() const {
+    syncHandles();
+    if (name_index_valid_) {
+        return;
+    }
+    
+    name_index_.clear();
+    name_index_.reserve(solutions_.size());
+    for (size_t position = 0; position < solutions_.size(); ++position) {
+        SolutionHandle handle;
+        handle.index = position_slots_[position];
+        handle.generation = slots_[handle.index].generation;
+        auto inserted = name_index_.emplace(solutions_[position]->getName(), NameEntry{handle, 0});
+        ++inserted.first->second.count;
+    }
+    name_index_valid_ = true;
+}
+
 std::vector<Solution*> SolutionDocument::getAllSolutions() const {
     std::vector<Solution*> result;
     for (const auto& solution : solutions_) {
@@ -59,3 +201,139 @@ std::vector<Solution*> SolutionDocument::getAllSolutions() const {
     return result;
 }
 
+SolveReport SolutionDocument::solveAll() {
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    
+    SolveReport report;
+    size_t count = solutions_.size();
+    report.entries.resize(count);
+    std::unordered_map<const Solution*, size_t> index;
+    index.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        report.entries[i].solution = solutions_[i].get();
+        report.entries[i].name = solutions_[i]->getName();
+        index.emplace(solutions_[i].get(), i);
+    }
+    
+    // Edges source -> target from every registered exchange inside the document
+    std::vector<std::vector<size_t>> dependents(count);
+    std::vector<size_t> indegree(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        for (DataExchange* exchange : solutions_[i]->getDataExchanges()) {
+            auto source = index.find(exchange->getSourceSolution());
+            auto target = index.find(exchange->getTargetSolution());
+            if (source == index.end() || target == index.end() || source->second == target->second) {
+                continue;
+            }
+            std::vector<size_t>& edges = dependents[source->second];
+            if (std::find(edges.begin(), edges.end(), target->second) == edges.end()) {
+                edges.push_back(target->second);
+                ++indegree[target->second];
+            }
+        }
+    }
+    
+    auto solveOne = [this, &report](size_t i) {
+        auto begin = Clock::now();
+        solutions_[i]->solve();
+        report.entries[i].milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    };
+    
+    // Level by level (Kahn), each level in document order
+    std::vector<size_t> level;
+    for (size_t i = 0; i < count; ++i) {
+        if (indegree[i] == 0) {
+            level.push_back(i);
+        }
+    }
+    std::vector<bool> solved(count, false);
+    TaskScheduler& scheduler = TaskScheduler::current();
+    while (!level.empty()) {
+        for (size_t i : level) {
+            report.entries[i].level = report.level_count;
+            solved[i] = true;
+        }
+        scheduler.parallelFor(0, level.size(), [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                solveOne(level[k]);
+            }
+        }, 1);
+        ++report.level_count;
+        
+        std::vector<size_t> next;
+        for (size_t i : level) {
+            for (size_t dependent : dependents[i]) {
+                if (--indegree[dependent] == 0) {
+                    next.push_back(dependent);
+                }
+            }
+        }
+        std::sort(next.begin(), next.end());
+        level.swap(next);
+    }
+    
+    // Cycles have no valid order, solve what is left serially in document order
+    for (size_t i = 0; i < count; ++i) {
+        if (!solved[i]) {
+            report.entries[i].level = report.level_count;
+            report.entries[i].in_cycle = true;
+            ++report.cyclic_count;
+            solveOne(i);
+        }
+    }
+    if (report.cyclic_count > 0) {
+        ++report.level_count;
+    }
+    
+    report.total_milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    return report;
+}
+
+bool SolutionDocument::enableJournal(const std::string& journal_path) {
+    auto journal = std::make_shared<HistoryJournal>(journal_path);
+    if (!journal->open()) {
+        return false;
+    }
+    disableJournal();
+    journal_ = std::move(journal);
+    if (isOpen()) {
+        recoverJournal();
+    }
+    return true;
+}
+
+void SolutionDocument::disableJournal() {
+    if (journal_) {
+        for (const auto& solution : solutions_) {
+            ConstructionHistory* history = solution->getConstructionHistory();
+            if (history->getJournal() == journal_) {
+                history->setJournal(nullptr);
+            }
+        }
+        journal_->close();
+        journal_.reset();
+    }
+    journal_recovered_ = false;
+}
+
+void SolutionDocument::recoverJournal() {
+    if (!journal_ || journal_recovered_) {
+        return;
+    }
+    for (const auto& solution : solutions_) {
+        attachJournal(*solution);
+    }
+    journal_recovered_ = true;
+}
+
+void SolutionDocument::attachJournal(Solution& solution) {
+    // Replay the steps recorded since the last save, then keep journaling into the same file
+    ConstructionHistory* history = solution.getConstructionHistory();
+    if (history->getJournal() == journal_) {
+        return;
+    }
+    journal_->flush();
+    HistoryJournal::replay(journal_->getPath(), solution.getName(), *history);
+    history->setJournal(journal_, solution.getName());
+}
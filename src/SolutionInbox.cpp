@@ -0,0 +1,171 @@
+#include "../include/SolutionInbox.h"
+#include "../include/Solution.h"
+
+namespace {
+
+// Inbox whose messages the calling thread is delivering, if any
+thread_local const SolutionInbox* consuming_inbox = nullptr;
+
+} // namespace
+
+SolutionInbox::SolutionInbox(Solution* owner, size_t capacity)
+    : owner_(owner), ring_(capacity), running_(false), worker_sleeping_(false), producers_waiting_(0) {
+}
+
+SolutionInbox::~SolutionInbox() {
+    stop();
+}
+
+std::future<DataBuffer> SolutionInbox::post(const DataBuffer& buffer) {
+    InboxMessage message{buffer, std::promise<DataBuffer>()};
+    std::future<DataBuffer> result = message.reply.get_future();
+    
+    if (consuming_inbox == this) {
+        // Posted from one of our own handlers. Waiting for room, or for a
+        // producer that waits for room itself, would wait on this very thread.
+        if (isRunning()) {
+            std::unique_lock<std::mutex> post_lock(post_mutex_, std::try_to_lock);
+            if (post_lock.owns_lock() && ring_.tryPush(std::move(message))) {
+                wakeWorker();
+                return result;
+            }
+        }
+        deliver(message);
+        return result;
+    }
+    
+    std::lock_guard<std::mutex> post_lock(post_mutex_);
+    if (!isRunning()) {
+        // No worker to wait for: the poster consumes, oldest message first
+        std::lock_guard<std::mutex> consume_lock(consume_mutex_);
+        drain(std::numeric_limits<size_t>::max());
+        deliver(message);
+        return result;
+    }
+    
+    // Backpressure: wait for the worker to make room. stop() takes
+    // post_mutex_, so the worker keeps draining until the push succeeds.
+    if (!ring_.tryPush(std::move(message))) {
+        wakeWorker();
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        producers_waiting_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // Pairs with the fence in drain()
+        space_cv_.wait(lock, [this, &message] { return ring_.tryPush(std::move(message)); });
+        producers_waiting_.fetch_sub(1);
+    }
+    wakeWorker();
+    return result;
+}
+
+bool SolutionInbox::tryPost(const DataBuffer& buffer, std::future<DataBuffer>& result) {
+    InboxMessage message{buffer, std::promise<DataBuffer>()};
+    std::future<DataBuffer> reply = message.reply.get_future();
+    std::lock_guard<std::mutex> lock(post_mutex_);
+    if (!ring_.tryPush(std::move(message))) {
+        return false;
+    }
+    result = std::move(reply);
+    wakeWorker();
+    return true;
+}
+
+size_t SolutionInbox::process(size_t max_messages) {
+    std::lock_guard<std::mutex> lock(consume_mutex_);
+    return drain(max_messages);
+}
+
+size_t SolutionInbox::drain(size_t max_messages) {
+    size_t processed = 0;
+    InboxMessage message;
+    while (processed < max_messages && ring_.tryPop(message)) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // Pairs with the fence in post()
+        if (producers_waiting_.load(std::memory_order_relaxed) > 0) {
+            wakeProducers();
+        }
+        deliver(message);
+        message = InboxMessage();
+        ++processed;
+    }
+    return processed;
+}
+
+void SolutionInbox::deliver(InboxMessage& message) {
+    const SolutionInbox* outer = consuming_inbox;
+    consuming_inbox = this;
+    try {
+        message.reply.set_value(owner_->receiveBuffer(message.buffer));
+    } catch (...) {
+        message.reply.set_exception(std::current_exception());
+    }
+    consuming_inbox = outer;
+}
+
+void SolutionInbox::start() {
+    std::lock_guard<std::mutex> lock(post_mutex_);
+    if (isRunning()) {
+        return;
+    }
+    running_.store(true, std::memory_order_release);
+    worker_ = std::thread(&SolutionInbox::workerLoop, this);
+}
+
+void SolutionInbox::stop(bool process_pending) {
+    {
+        // Once running_ is false every later post() is synchronous
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        if (!isRunning()) {
+            return;
+        }
+        running_.store(false, std::memory_order_release);
+    }
+    wakeWorker();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    
+    std::lock_guard<std::mutex> lock(consume_mutex_);
+    if (process_pending) {
+        drain(std::numeric_limits<size_t>::max()); // Complete anything posted before the worker stopped
+        return;
+    }
+    InboxMessage message;
+    while (ring_.tryPop(message)) {
+        message = InboxMessage();
+    }
+}
+
+void SolutionInbox::workerLoop() {
+    int idle = 0;
+    while (isRunning()) {
+        if (process(ring_.capacity()) > 0) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        
+        // Sleep until a producer posts. Either the producer sees the flag
+        // or the worker sees the message, so no wakeup is missed.
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        worker_sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake_cv_.wait(lock, [this] { return !ring_.empty() || !isRunning(); });
+        worker_sleeping_.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void SolutionInbox::wakeWorker() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // Pairs with the fence in workerLoop()
+    if (worker_sleeping_.load(std::memory_order_relaxed) || !isRunning()) {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_cv_.notify_one();
+    }
+}
+
+void SolutionInbox::wakeProducers() {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    space_cv_.notify_all();
+}
@@ -0,0 +1,247 @@
+#include "../include/TaskScheduler.h"
+#include <algorithm>
+
+namespace {
+
+// Worker identity of the calling thread
+thread_local TaskScheduler* current_scheduler = nullptr;
+thread_local size_t current_worker = 0;
+thread_local TaskScheduler* bound_scheduler = nullptr;
+
+} // namespace
+
+TaskScheduler::TaskScheduler(size_t worker_count)
+    : queued_(0), next_queue_(0), sleeping_(0), stopping_(false) {
+    if (worker_count == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        worker_count = hardware > 1 ? hardware - 1 : 1;
+    }
+    
+    for (size_t i = 0; i < worker_count; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    stopping_.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_cv_.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+TaskScheduler& TaskScheduler::instance() {
+    static TaskScheduler scheduler;
+    return scheduler;
+}
+
+TaskScheduler& TaskScheduler::current() {
+    if (current_scheduler) {
+        return *current_scheduler;
+    }
+    return bound_scheduler ? *bound_scheduler : instance();
+}
+
+TaskScheduler* TaskScheduler::bindThread(TaskScheduler* scheduler) {
+    TaskScheduler* previous = bound_scheduler;
+    bound_scheduler = scheduler;
+    return previous;
+}
+
+int TaskScheduler::getCurrentWorker() const {
+    return current_scheduler == this ? static_cast<int>(current_worker) : -1;
+}
+
+void TaskScheduler::submit(Task task) {
+    // Workers keep their own tasks local, other threads spread them out
+    size_t index = current_scheduler == this
+        ? current_worker
+        : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1);
+    
+    if (sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_cv_.notify_one();
+    }
+}
+
+bool TaskScheduler::takeTask(size_t index, Task& task) {
+    if (queued_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    
+    // Own deque first, newest task is the one most likely still in cache
+    {
+        WorkerQueue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    
+    // Steal the oldest task of another worker
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        WorkerQueue& victim = *queues_[(index + offset) % queues_.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (lock.owns_lock() && !victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::workerLoop(size_t index) {
+    current_scheduler = this;
+    current_worker = index;
+    
+    int idle = 0;
+    Task task;
+    while (true) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+            idle = 0;
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire) && queued_.load() == 0) {
+            break;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        
+        // Sleep until a task is submitted. submit() counts the task before it
+        // reads sleeping_, so either it sees this worker or the worker sees the task.
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleeping_.fetch_add(1);
+        wake_cv_.wait(lock, [this] { return queued_.load() > 0 || stopping_.load(std::memory_order_acquire); });
+        sleeping_.fetch_sub(1);
+        idle = 0;
+    }
+    
+    current_scheduler = nullptr;
+}
+
+void TaskScheduler::parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body, size_t grain) {
+    if (begin >= end) {
+        return;
+    }
+    
+    size_t count = end - begin;
+    if (grain == 0) {
+        grain = std::max<size_t>(1, count / ((workers_.size() + 1) * 4));
+    }
+    if (count <= grain) {
+        body(begin, end);
+        return;
+    }
+    
+    TaskGroup group(*this);
+    size_t chunk_begin = begin;
+    while (end - chunk_begin > grain) {
+        size_t chunk_end = chunk_begin + grain;
+        group.run([&body, chunk_begin, chunk_end]() { body(chunk_begin, chunk_end); });
+        chunk_begin = chunk_end;
+    }
+    
+    // The caller takes the last chunk itself
+    body(chunk_begin, end);
+    group.wait();
+}
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler)
+    : scheduler_(scheduler), state_(std::make_shared<State>()) {
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+        // Errors of an abandoned group are dropped, call wait() to observe them
+    }
+}
+
+void TaskGroup::run(TaskScheduler::Task task) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->queued.push_back(std::move(task));
+        ++state_->pending;
+    }
+    state_->changed_cv.notify_all();
+    
+    // The worker finds nothing to do if the waiter got to the task first
+    scheduler_.submit([state = state_]() { runQueued(*state); });
+}
+
+void TaskGroup::wait() {
+    State& state = *state_;
+    std::unique_lock<std::mutex> lock(state.mutex);
+    while (state.pending > 0) {
+        if (state.queued.empty()) {
+            state.changed_cv.wait(lock);
+            continue;
+        }
+        lock.unlock();
+        runQueued(state);
+        lock.lock();
+    }
+    
+    std::exception_ptr error;
+    std::swap(error, state.error);
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool TaskGroup::isDone() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->pending == 0;
+}
+
+bool TaskGroup::runQueued(State& state) {
+    TaskScheduler::Task task;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.queued.empty()) {
+            return false;
+        }
+        task = std::move(state.queued.front());
+        state.queued.pop_front();
+    }
+    
+    std::exception_ptr error;
+    try {
+        task();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (error && !state.error) {
+        state.error = error;
+    }
+    if (--state.pending == 0) {
+        state.changed_cv.notify_all();
+    }
+    return true;
+}
@@ -0,0 +1,355 @@
+#include "../include/ThumbnailRenderer.h"
+#include "../include/SoftwareRenderer.h"
+#include "../include/TaskScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t FNV_OFFSET = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Character-level scanner for the "x" and "y" members Document2D::saveToJSON
+// writes, so a point never depends on where a read block ends
+class PointScanner {
+public:
+    explicit PointScanner(const std::function<void(double, double)>& point)
+        : point_(point), state_(State::NORMAL), key_length_(0), axis_(0),
+          number_length_(0), has_x_(false), has_y_(false), x_(0.0), y_(0.0) {
+    }
+    
+    void feed(const char* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            consume(data[i]);
+        }
+    }
+    
+    void finish() {
+        if (state_ == State::NUMBER) {
+            endNumber();
+        }
+    }
+    
+private:
+    enum class State {
+        NORMAL,
+        STRING,
+        ESCAPE,
+        AFTER_STRING,  // A string closed, a ':' makes it a key
+        VALUE,         // After "x": or "y":
+        NUMBER
+    };
+    
+    static const size_t MAX_KEY = 8;
+    static const size_t MAX_NUMBER = 63;
+    
+    const std::function<void(double, double)>& point_;
+    State state_;
+    char key_[MAX_KEY];
+    size_t key_length_;
+    int axis_;
+    char number_[MAX_NUMBER + 1];
+    size_t number_length_;
+    bool has_x_, has_y_;
+    double x_, y_;
+    
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+    static bool isNumberChar(char c) {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+    
+    void consume(char c) {
+        switch (state_) {
+            case State::NORMAL:
+                if (c == '"') {
+                    state_ = State::STRING;
+                    key_length_ = 0;
+                } else if (c == '{') {
+                    has_x_ = has_y_ = false;
+                }
+                break;
+            case State::STRING:
+                if (c == '\\') {
+                    state_ = State::ESCAPE;
+                } else if (c == '"') {
+                    state_ = State::AFTER_STRING;
+                } else if (key_length_ < MAX_KEY) {
+                    key_[key_length_++] = c;
+                } else {
+                    key_length_ = MAX_KEY + 1;
+                }
+                break;
+            case State::ESCAPE:
+                key_length_ = MAX_KEY + 1;  // Escaped names are never x or y
+                state_ = State::STRING;
+                break;
+            case State::AFTER_STRING:
+                if (isSpace(c)) {
+                    break;
+                }
+                if (c == ':' && key_length_ == 1 && (key_[0] == 'x' || key_[0] == 'y')) {
+                    axis_ = key_[0] == 'x' ? 0 : 1;
+                    state_ = State::VALUE;
+                    break;
+                }
+                state_ = State::NORMAL;
+                if (c != ':') {
+                    consume(c);
+                }
+                break;
+            case State::VALUE:
+                if (isSpace(c)) {
+                    break;
+                }
+                if (isNumberChar(c)) {
+                    number_length_ = 0;
+                    number_[number_length_++] = c;
+                    state_ = State::NUMBER;
+                } else {
+                    state_ = State::NORMAL;
+                    consume(c);
+                }
+                break;
+            case State::NUMBER:
+                if (isNumberChar(c)) {
+                    if (number_length_ < MAX_NUMBER) {
+                        number_[number_length_++] = c;
+                    }
+                    break;
+                }
+                endNumber();
+                consume(c);
+                break;
+        }
+    }
+    
+    void endNumber() {
+        number_[number_length_] = '\0';
+        double value = std::strtod(number_, nullptr);
+        if (axis_ == 0) {
+            x_ = value;
+            has_x_ = true;
+        } else {
+            y_ = value;
+            has_y_ = true;
+        }
+        state_ = State::NORMAL;
+        if (has_x_ && has_y_) {
+            has_x_ = has_y_ = false;
+            point_(x_, y_);
+        }
+    }
+};
+
+} // namespace
+
+ThumbnailRenderer::ThumbnailRenderer(const std::string& cache_directory, const ThumbnailOptions& options)
+    : cache_directory_(cache_directory), options_(options) {
+    options_.size = std::max(options_.size, 1);
+    options_.batch_points = std::max<size_t>(options_.batch_points, 1);
+}
+
+bool ThumbnailRenderer::streamPoints(const std::string& path, const std::function<void(double, double)>& point) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    PointScanner scanner(point);
+    std::vector<char> block(READ_BLOCK);
+    while (file) {
+        file.read(block.data(), block.size());
+        scanner.feed(block.data(), static_cast<size_t>(file.gcount()));
+    }
+    scanner.finish();
+    return !file.bad();
+}
+
+bool ThumbnailRenderer::hashFile(const std::string& path, uint64_t seed, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    hash = seed;
+    std::vector<char> block(READ_BLOCK);
+    while (file) {
+        file.read(block.data(), block.size());
+        hash = fnv1a(hash, block.data(), static_cast<size_t>(file.gcount()));
+    }
+    return !file.bad();
+}
+
+uint64_t ThumbnailRenderer::optionsHash() const {
+    // Same document with other options is another image
+    uint64_t hash = fnv1a(FNV_OFFSET, &options_.size, sizeof(options_.size));
+    hash = fnv1a(hash, options_.point_color, sizeof(options_.point_color));
+    return fnv1a(hash, options_.background, sizeof(options_.background));
+}
+
+std::string ThumbnailRenderer::imagePath(uint64_t hash) const {
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".png";
+    return (std::filesystem::path(cache_directory_) / name.str()).string();
+}
+
+ThumbnailResult ThumbnailRenderer::renderFile(const std::string& document_path) const {
+    ThumbnailResult result;
+    result.document_path = document_path;
+    if (!hashFile(document_path, optionsHash(), result.hash)) {
+        return result;
+    }
+    result.image_path = imagePath(result.hash);
+    std::error_code error;
+    if (std::filesystem::exists(result.image_path, error)) {
+        result.status = ThumbnailStatus::CACHED;
+        return result;
+    }
+    
+    // First pass: bounds
+    double min_x = std::numeric_limits<double>::max();
+    double min_y = std::numeric_limits<double>::max();
+    double max_x = std::numeric_limits<double>::lowest();
+    double max_y = std::numeric_limits<double>::lowest();
+    size_t count = 0;
+    bool read = streamPoints(document_path, [&](double x, double y) {
+        min_x = std::min(min_x, x);
+        min_y = std::min(min_y, y);
+        max_x = std::max(max_x, x);
+        max_y = std::max(max_y, y);
+        ++count;
+    });
+    if (!read) {
+        return result;
+    }
+    
+    // Fit the bounds into the image with a small margin, keeping the aspect
+    int size = options_.size;
+    SoftwareRenderer renderer(size, size);
+    renderer.initialize();
+    renderer.beginRender();
+    renderer.clear(options_.background[0], options_.background[1], options_.background[2], options_.background[3]);
+    float projection[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    if (count > 0) {
+        double extent = std::max(max_x - min_x, max_y - min_y);
+        double scale = extent > 0.0 ? 1.9 / extent : 1.0;
+        projection[0] = projection[5] = static_cast<float>(scale);
+        projection[12] = static_cast<float>(-(min_x + max_x) * 0.5 * scale);
+        projection[13] = static_cast<float>(-(min_y + max_y) * 0.5 * scale);
+    }
+    renderer.setProjectionMatrix(projection);
+    
+    // Second pass: draw in batches, flushing each so the bins stay small
+    const float* color = options_.point_color;
+    Vertex3D vertex{0.0f, 0.0f, 0.0f, color[0], color[1], color[2], color[3], 0.0f, 0.0f, 0.0f};
+    std::vector<Vertex3D> batch;
+    batch.reserve(options_.batch_points);
+    auto drawBatch = [&]() {
+        renderer.drawPoints(batch);
+        renderer.flush();
+        result.points += batch.size();
+        batch.clear();
+    };
+    read = streamPoints(document_path, [&](double x, double y) {
+        vertex.x = static_cast<float>(x);
+        vertex.y = static_cast<float>(y);
+        batch.push_back(vertex);
+        if (batch.size() == options_.batch_points) {
+            drawBatch();
+        }
+    });
+    if (!read) {
+        return result;
+    }
+    drawBatch();
+    renderer.endRender();
+    
+    // Write under a temporary name so an interrupted run never leaves a
+    // partial image that later counts as cached. The name is unique per
+    // write: identical documents share the image path.
+    static std::atomic<uint64_t> temporary_counter{0};
+    std::filesystem::create_directories(cache_directory_, error);
+    std::string temporary = result.image_path + "." + std::to_string(::getpid()) + "." +
+                            std::to_string(temporary_counter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+    if (!renderer.writePNG(temporary)) {
+        std::filesystem::remove(temporary, error);
+        return result;
+    }
+    std::filesystem::rename(temporary, result.image_path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return result;
+    }
+    result.status = ThumbnailStatus::RENDERED;
+    return result;
+}
+
+std::vector<ThumbnailResult> ThumbnailRenderer::renderDirectory(const std::string& directory, bool recursive) const {
+    std::vector<std::string> documents;
+    std::error_code error;
+    auto collect = [&documents](const std::filesystem::directory_entry& entry) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+            documents.push_back(entry.path().string());
+        }
+    };
+    if (recursive) {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error)) {
+            collect(entry);
+        }
+    } else {
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            collect(entry);
+        }
+    }
+    std::sort(documents.begin(), documents.end());
+    
+    // Scheduler tasks, each rendering one document at a time with its own
+    // renderer and batch. Waiting inside a render only runs that render's
+    // own chunks, so a task never holds more than one document.
+    std::vector<ThumbnailResult> results(documents.size());
+    size_t worker_count = options_.workers > 0 ? options_.workers : std::max(1u, std::thread::hardware_concurrency());
+    worker_count = std::min(worker_count, documents.size());
+    std::atomic<size_t> next(0);
+    auto work = [this, &documents, &results, &next]() {
+        for (size_t i = next.fetch_add(1); i < documents.size(); i = next.fetch_add(1)) {
+            results[i] = renderFile(documents[i]);
+        }
+    };
+    TaskGroup group(TaskScheduler::current());
+    for (size_t w = 1; w < worker_count; ++w) {
+        group.run(work);
+    }
+    work();
+    group.wait();
+    
+    std::filesystem::create_directories(cache_directory_, error);
+    std::string index = (std::filesystem::path(cache_directory_) / "index.txt").string();
+    std::ofstream file(index + ".tmp");
+    if (file.is_open()) {
+        for (const ThumbnailResult& result : results) {
+            if (result.status != ThumbnailStatus::FAILED) {
+                file << std::filesystem::path(result.image_path).filename().string() << " " << result.document_path << "\n";
+            }
+        }
+        file.close();
+        std::filesystem::rename(index + ".tmp", index, error);
+    }
+    return results;
+}
@@ -1,14 +1,27 @@
 #include "../include/Value.h"
-#include <sstream>
-#include <stdexcept>
-#include <algorithm>
-#include <cctype>
 
-Value::Value() : Solution(), type_(ValueType::UNDEFINED) {
-    data_ = 0;
+Value::Value()
+    : Solution(), conversion_cache_enabled_(false), cached_flags_(0), cached_int_(0), cached_double_(0.0) {
     setName("Value");
 }
 
+Value::Value(const ValueData& data)
+    : Solution(), data_(data), conversion_cache_enabled_(false), cached_flags_(0), cached_int_(0), cached_double_(0.0) {
+    setName("Value");
+}
+
+Value::Value(const Value& other)
+    : Solution(), data_(other.data_), conversion_cache_enabled_(other.conversion_cache_enabled_),
+      cached_flags_(0), cached_int_(0), cached_double_(0.0) {
+    setName(other.getName());
+}
+
+Value& Value::operator=(const Value& other) {
+    data_ = other.data_;
+    invalidateCache();
+    return *this;
+}
+
 // Implementation of pure virtual methods from Solution
 void Value::solve() {
     // Value solution implementation
@@ -39,99 +52,67 @@ void Value::similar_make() {
 }
 
 void Value::setInt(int value) {
-    type_ = ValueType::INTEGER;
-    data_ = value;
+    data_ = ValueData::fromInt(value);
+    invalidateCache();
 }
 
 void Value::setDouble(double value) {
-    type_ = ValueType::DOUBLE;
-    data_ = value;
+    data_ = ValueData::fromDouble(value);
+    invalidateCache();
 }
 
 void Value::setString(const std::string& value) {
-    type_ = ValueType::STRING;
-    data_ = value;
+    data_ = ValueData::fromString(value);
+    invalidateCache();
 }
 
 void Value::setBool(bool value) {
-    type_ = ValueType::BOOLEAN;
-    data_ = value;
+    data_ = ValueData::fromBool(value);
+    invalidateCache();
 }
 
 void Value::setPointer(void* value) {
-    type_ = ValueType::POINTER;
-    data_ = value;
+    data_ = ValueData::fromPointer(value);
+    invalidateCache();
 }
 
 int Value::getInt() const {
-    if (type_ == ValueType::INTEGER) {
-        return std::get<int>(data_);
-    } else if (type_ == ValueType::DOUBLE) {
-        return static_cast<int>(std::get<double>(data_));
-    } else if (type_ == ValueType::BOOLEAN) {
-        return std::get<bool>(data_) ? 1 : 0;
-    } else if (type_ == ValueType::STRING) {
-        try {
-            return std::stoi(std::get<std::string>(data_));
-        } catch (...) {
-            return 0;
-        }
+    // Only string parsing is worth caching, the other conversions are a cast
+    if (!conversion_cache_enabled_ || data_.getType() != ValueType::STRING) {
+        return data_.toInt();
+    }
+    if (!(cached_flags_ & CACHED_INT)) {
+        cached_int_ = data_.toInt();
+        cached_flags_ |= CACHED_INT;
     }
-    return 0;
+    return cached_int_;
 }
 
 double Value::getDouble() const {
-    if (type_ == ValueType::DOUBLE) {
-        return std::get<double>(data_);
-    } else if (type_ == ValueType::INTEGER) {
-        return static_cast<double>(std::get<int>(data_));
-    } else if (type_ == ValueType::BOOLEAN) {
-        return std::get<bool>(data_) ? 1.0 : 0.0;
-    } else if (type_ == ValueType::STRING) {
-        try {
-            return std::stod(std::get<std::string>(data_));
-        } catch (...) {
-            return 0.0;
-        }
+    if (!conversion_cache_enabled_ || data_.getType() != ValueType::STRING) {
+        return data_.toDouble();
     }
-    return 0.0;
+    if (!(cached_flags_ & CACHED_DOUBLE)) {
+        cached_double_ = data_.toDouble();
+        cached_flags_ |= CACHED_DOUBLE;
+    }
+    return cached_double_;
 }
 
 std::string Value::getString() const {
-    if (type_ == ValueType::STRING) {
-        return std::get<std::string>(data_);
-    } else if (type_ == ValueType::INTEGER) {
-        return std::to_string(std::get<int>(data_));
-    } else if (type_ == ValueType::DOUBLE) {
-        return std::to_string(std::get<double>(data_));
-    } else if (type_ == ValueType::BOOLEAN) {
-        return std::get<bool>(data_) ? "true" : "false";
-    } else if (type_ == ValueType::POINTER) {
-        std::ostringstream oss;
-        oss << std::get<void*>(data_);
-        return oss.str();
+    if (!conversion_cache_enabled_) {
+        return data_.toString();
     }
-    return "";
+    return std::string(toStringView());
 }
 
 bool Value::getBool() const {
-    if (type_ == ValueType::BOOLEAN) {
-        return std::get<bool>(data_);
-    } else if (type_ == ValueType::INTEGER) {
-        return std::get<int>(data_) != 0;
-    } else if (type_ == ValueType::DOUBLE) {
-        return std::get<double>(data_) != 0.0;
-    } else if (type_ == ValueType::STRING) {
-        std::string str = std::get<std::string>(data_);
-        std::transform(str.begin(), str.end(), str.begin(), ::tolower);
-        return str == "true" || str == "1" || str == "yes";
-    }
-    return false;
+    return data_.toBool();
 }
 
 void* Value::getPointer() const {
-    if (type_ == ValueType::POINTER) {
-        return std::get<void*>(data_);
+    if (data_.getType() == ValueType::POINTER) {
+        return data_.asPointer();
     }
     return nullptr;
 }
@@ -152,38 +133,61 @@ double Value::toDouble() const {
     return getDouble();
 }
 
+void Value::setConversionCacheEnabled(bool enabled) {
+    conversion_cache_enabled_ = enabled;
+    invalidateCache();
+    if (!enabled) {
+        cached_string_.clear();
+        cached_string_.shrink_to_fit();
+    }
+}
+
+std::string_view Value::toStringView() const {
+    if (data_.getType() == ValueType::STRING) {
+        return data_.asString(); // Inline or interned, no formatting needed
+    }
+    if (!(cached_flags_ & CACHED_STRING)) {
+        cached_string_.clear();
+        data_.appendTo(cached_string_);
+        cached_flags_ |= CACHED_STRING;
+    }
+    return cached_string_;
+}
+
 bool Value::isValid() const {
-    return type_ != ValueType::UNDEFINED;
+    return data_.isValid();
 }
 
 void Value::clear() {
-    type_ = ValueType::UNDEFINED;
-    data_ = 0;
+    data_ = ValueData();
+    invalidateCache();
 }
 
 bool Value::equals(const Value& other) const {
-    if (type_ != other.type_) {
+    ValueType type = data_.getType();
+    ValueType other_type = other.data_.getType();
+    if (type != other_type) {
         // Try to compare by converting to same type
-        if (type_ == ValueType::INTEGER && other.type_ == ValueType::DOUBLE) {
+        if (type == ValueType::INTEGER && other_type == ValueType::DOUBLE) {
             return getInt() == other.getInt();
         }
-        if (type_ == ValueType::DOUBLE && other.type_ == ValueType::INTEGER) {
+        if (type == ValueType::DOUBLE && other_type == ValueType::INTEGER) {
             return getInt() == other.getInt();
         }
         return toString() == other.toString();
     }
     
-    switch (type_) {
+    switch (type) {
         case ValueType::INTEGER:
-            return std::get<int>(data_) == std::get<int>(other.data_);
+            return data_.asInt() == other.data_.asInt();
         case ValueType::DOUBLE:
-            return std::get<double>(data_) == std::get<double>(other.data_);
+            return data_.asDouble() == other.data_.asDouble();
         case ValueType::STRING:
-            return std::get<std::string>(data_) == std::get<std::string>(other.data_);
+            return data_.asString() == other.data_.asString();
         case ValueType::BOOLEAN:
-            return std::get<bool>(data_) == std::get<bool>(other.data_);
+            return data_.asBool() == other.data_.asBool();
         case ValueType::POINTER:
-            return std::get<void*>(data_) == std::get<void*>(other.data_);
+            return data_.asPointer() == other.data_.asPointer();
         default:
             return false;
     }
@@ -198,59 +202,23 @@ bool Value::operator!=(const Value& other) const {
 }
 
 Value Value::operator+(const Value& other) const {
-    Value result;
-    if (type_ == ValueType::INTEGER && other.type_ == ValueType::INTEGER) {
-        result.setInt(getInt() + other.getInt());
-    } else if ((type_ == ValueType::DOUBLE || type_ == ValueType::INTEGER) &&
-               (other.type_ == ValueType::DOUBLE || other.type_ == ValueType::INTEGER)) {
-        result.setDouble(getDouble() + other.getDouble());
-    } else if (type_ == ValueType::STRING || other.type_ == ValueType::STRING) {
-        result.setString(toString() + other.toString());
-    }
-    return result;
+    return Value(ValueData::add(data_, other.data_));
 }
 
 Value Value::operator-(const Value& other) const {
-    Value result;
-    if (type_ == ValueType::INTEGER && other.type_ == ValueType::INTEGER) {
-        result.setInt(getInt() - other.getInt());
-    } else if ((type_ == ValueType::DOUBLE || type_ == ValueType::INTEGER) &&
-               (other.type_ == ValueType::DOUBLE || other.type_ == ValueType::INTEGER)) {
-        result.setDouble(getDouble() - other.getDouble());
-    }
-    return result;
+    return Value(ValueData::subtract(data_, other.data_));
 }
 
 Value Value::operator*(const Value& other) const {
-    Value result;
-    if (type_ == ValueType::INTEGER && other.type_ == ValueType::INTEGER) {
-        result.setInt(getInt() * other.getInt());
-    } else if ((type_ == ValueType::DOUBLE || type_ == ValueType::INTEGER) &&
-               (other.type_ == ValueType::DOUBLE || other.type_ == ValueType::INTEGER)) {
-        result.setDouble(getDouble() * other.getDouble());
-    }
-    return result;
+    return Value(ValueData::multiply(data_, other.data_));
 }
 
 Value Value::operator/(const Value& other) const {
-    Value result;
-    if (type_ == ValueType::INTEGER && other.type_ == ValueType::INTEGER) {
-        int divisor = other.getInt();
-        if (divisor != 0) {
-            result.setInt(getInt() / divisor);
-        }
-    } else if ((type_ == ValueType::DOUBLE || type_ == ValueType::INTEGER) &&
-               (other.type_ == ValueType::DOUBLE || other.type_ == ValueType::INTEGER)) {
-        double divisor = other.getDouble();
-        if (divisor != 0.0) {
-            result.setDouble(getDouble() / divisor);
-        }
-    }
-    return result;
+    return Value(ValueData::divide(data_, other.data_));
 }
 
 void Value::convertTo(ValueType target_type) {
-    if (type_ == target_type) {
+    if (data_.getType() == target_type) {
         return;
     }
     
@@ -267,25 +235,29 @@ void Value::convertTo(ValueType target_type) {
         case ValueType::BOOLEAN:
             setBool(getBool());
             break;
+        case ValueType::UNDEFINED:
+            clear();
+            break;
         default:
             break;
     }
 }
 
 bool Value::canConvertTo(ValueType target_type) const {
-    if (type_ == target_type) {
+    ValueType type = data_.getType();
+    if (type == target_type) {
         return true;
     }
     
     switch (target_type) {
         case ValueType::INTEGER:
         case ValueType::DOUBLE:
-            return type_ == ValueType::INTEGER || type_ == ValueType::DOUBLE || 
-                   type_ == ValueType::BOOLEAN || type_ == ValueType::STRING;
+            return type == ValueType::INTEGER || type == ValueType::DOUBLE || 
+                   type == ValueType::BOOLEAN || type == ValueType::STRING;
         case ValueType::STRING:
             return true; // Can always convert to string
         case ValueType::BOOLEAN:
-            return type_ != ValueType::POINTER && type_ != ValueType::UNDEFINED;
+            return type != ValueType::POINTER && type != ValueType::UNDEFINED;
         default:
             return false;
     }
@@ -0,0 +1,469 @@
+#include "../include/ValueColumn.h"
+#include <algorithm>
+
+namespace {
+
+// Tight loops over restrict pointers so the compiler can vectorize them
+template<typename T, typename Op>
+void binaryKernel(const T* __restrict a, const T* __restrict b, T* __restrict out, size_t size, Op op) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = op(a[i], b[i]);
+    }
+}
+
+template<typename T, typename Op>
+void compareKernel(const T* __restrict a, const T* __restrict b, uint8_t* __restrict out, size_t size, Op op) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = op(a[i], b[i]) ? 1 : 0;
+    }
+}
+
+template<typename From, typename To>
+void convertKernel(const From* __restrict in, To* __restrict out, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = static_cast<To>(in[i]);
+    }
+}
+
+bool isColumnType(ValueData::Type type) {
+    return type == ValueData::Type::INTEGER || type == ValueData::Type::DOUBLE ||
+           type == ValueData::Type::BOOLEAN || type == ValueData::Type::STRING;
+}
+
+} // namespace
+
+ValueColumn::ValueColumn() : ValueColumn(Type::UNDEFINED) {
+}
+
+ValueColumn::ValueColumn(Type type) : type_(type), size_(0) {
+    string_offsets_.push_back(0);
+}
+
+ValueColumn ValueColumn::fromInts(const std::vector<int>& values) {
+    ValueColumn column(Type::INTEGER);
+    column.resize(values.size());
+    std::copy(values.begin(), values.end(), column.ints_.begin());
+    return column;
+}
+
+ValueColumn ValueColumn::fromDoubles(const std::vector<double>& values) {
+    ValueColumn column(Type::DOUBLE);
+    column.resize(values.size());
+    std::copy(values.begin(), values.end(), column.doubles_.begin());
+    return column;
+}
+
+ValueColumn ValueColumn::fromBools(const std::vector<bool>& values) {
+    ValueColumn column(Type::BOOLEAN);
+    column.resize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        column.bools_[i] = values[i] ? 1 : 0;
+    }
+    return column;
+}
+
+ValueColumn ValueColumn::fromStrings(const std::vector<std::string>& values) {
+    ValueColumn column(Type::STRING);
+    size_t chars = 0;
+    for (const auto& value : values) {
+        chars += value.size();
+    }
+    column.string_chars_.reserve(chars);
+    column.resize(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        column.string_chars_.append(values[i]);
+        column.string_offsets_[i + 1] = static_cast<uint32_t>(column.string_chars_.size());
+    }
+    return column;
+}
+
+ValueColumn ValueColumn::nulls(Type type, size_t size) {
+    ValueColumn column(type);
+    column.resize(size);
+    std::fill(column.null_bits_.begin(), column.null_bits_.end(), ~uint64_t(0));
+    if (size % 64 != 0) {
+        column.null_bits_.back() = (uint64_t(1) << (size % 64)) - 1;  // Keep bits past the end clear
+    }
+    return column;
+}
+
+void ValueColumn::reserve(size_t size) {
+    null_bits_.reserve((size + 63) / 64);
+    switch (type_) {
+        case Type::INTEGER:
+            ints_.reserve(size);
+            break;
+        case Type::DOUBLE:
+            doubles_.reserve(size);
+            break;
+        case Type::BOOLEAN:
+            bools_.reserve(size);
+            break;
+        case Type::STRING:
+            string_offsets_.reserve(size + 1);
+            break;
+        default:
+            break;
+    }
+}
+
+void ValueColumn::clear() {
+    size_ = 0;
+    null_bits_.clear();
+    ints_.clear();
+    doubles_.clear();
+    bools_.clear();
+    string_offsets_.assign(1, 0);
+    string_chars_.clear();
+}
+
+void ValueColumn::append(const ValueData& value) {
+    if (!value.isValid() || !isColumnType(type_)) {
+        appendNull();
+        return;
+    }
+    
+    size_t index = size_;
+    resize(size_ + 1);
+    switch (type_) {
+        case Type::INTEGER:
+            ints_[index] = value.toInt();
+            break;
+        case Type::DOUBLE:
+            doubles_[index] = value.toDouble();
+            break;
+        case Type::BOOLEAN:
+            bools_[index] = value.toBool() ? 1 : 0;
+            break;
+        case Type::STRING:
+            value.appendTo(string_chars_);
+            string_offsets_[index + 1] = static_cast<uint32_t>(string_chars_.size());
+            break;
+        default:
+            break;
+    }
+}
+
+void ValueColumn::appendNull() {
+    size_t index = size_;
+    resize(size_ + 1);
+    setNull(index);
+}
+
+ValueData ValueColumn::get(size_t index) const {
+    if (index >= size_ || isNull(index)) {
+        return ValueData();
+    }
+    switch (type_) {
+        case Type::INTEGER:
+            return ValueData::fromInt(ints_[index]);
+        case Type::DOUBLE:
+            return ValueData::fromDouble(doubles_[index]);
+        case Type::BOOLEAN:
+            return ValueData::fromBool(bools_[index] != 0);
+        case Type::STRING:
+            return ValueData::fromStringView(stringAt(index));
+        default:
+            return ValueData();
+    }
+}
+
+size_t ValueColumn::getNullCount() const {
+    size_t count = 0;
+    for (uint64_t word : null_bits_) {
+        count += static_cast<size_t>(__builtin_popcountll(word));
+    }
+    return count;
+}
+
+std::string_view ValueColumn::stringAt(size_t index) const {
+    if (type_ != Type::STRING || index >= size_) {
+        return std::string_view();
+    }
+    return std::string_view(string_chars_.data() + string_offsets_[index],
+                            string_offsets_[index + 1] - string_offsets_[index]);
+}
+
+ValueColumn ValueColumn::add(const ValueColumn& a, const ValueColumn& b) {
+    return arithmetic(a, b, Operation::ADD);
+}
+
+ValueColumn ValueColumn::subtract(const ValueColumn& a, const ValueColumn& b) {
+    return arithmetic(a, b, Operation::SUBTRACT);
+}
+
+ValueColumn ValueColumn::multiply(const ValueColumn& a, const ValueColumn& b) {
+    return arithmetic(a, b, Operation::MULTIPLY);
+}
+
+ValueColumn ValueColumn::divide(const ValueColumn& a, const ValueColumn& b) {
+    return arithmetic(a, b, Operation::DIVIDE);
+}
+
+ValueColumn ValueColumn::equal(const ValueColumn& a, const ValueColumn& b) {
+    return compare(a, b, Comparison::EQUAL);
+}
+
+ValueColumn ValueColumn::notEqual(const ValueColumn& a, const ValueColumn& b) {
+    return compare(a, b, Comparison::NOT_EQUAL);
+}
+
+ValueColumn ValueColumn::less(const ValueColumn& a, const ValueColumn& b) {
+    return compare(a, b, Comparison::LESS);
+}
+
+ValueColumn ValueColumn::greater(const ValueColumn& a, const ValueColumn& b) {
+    return compare(a, b, Comparison::GREATER);
+}
+
+ValueColumn ValueColumn::cast(Type target) const {
+    if (target == type_) {
+        return *this;
+    }
+    if (!isColumnType(target) || !isColumnType(type_)) {
+        return nulls(target, size_);
+    }
+    
+    ValueColumn result(target);
+    if (target == Type::STRING) {
+        // Format straight into the character buffer, no per-element strings
+        result.resize(size_);
+        result.null_bits_ = null_bits_;
+        for (size_t i = 0; i < size_; ++i) {
+            if (!isNull(i)) {
+                get(i).appendTo(result.string_chars_);
+            }
+            result.string_offsets_[i + 1] = static_cast<uint32_t>(result.string_chars_.size());
+        }
+        return result;
+    }
+    
+    result.resize(size_);
+    result.null_bits_ = null_bits_;
+    if (target == Type::DOUBLE && type_ == Type::INTEGER) {
+        convertKernel(ints_.data(), result.doubles_.data(), size_);
+    } else if (target == Type::DOUBLE && type_ == Type::BOOLEAN) {
+        convertKernel(bools_.data(), result.doubles_.data(), size_);
+    } else if (target == Type::INTEGER && type_ == Type::DOUBLE) {
+        convertKernel(doubles_.data(), result.ints_.data(), size_);
+    } else if (target == Type::INTEGER && type_ == Type::BOOLEAN) {
+        convertKernel(bools_.data(), result.ints_.data(), size_);
+    } else if (target == Type::BOOLEAN && type_ == Type::INTEGER) {
+        for (size_t i = 0; i < size_; ++i) {
+            result.bools_[i] = ints_[i] != 0;
+        }
+    } else if (target == Type::BOOLEAN && type_ == Type::DOUBLE) {
+        for (size_t i = 0; i < size_; ++i) {
+            result.bools_[i] = doubles_[i] != 0.0;
+        }
+    } else {
+        // From strings, element by element through the scalar conversion rules
+        for (size_t i = 0; i < size_; ++i) {
+            if (isNull(i)) {
+                continue;
+            }
+            std::string_view text = stringAt(i);
+            if (target == Type::INTEGER) {
+                result.ints_[i] = ValueData::parseInt(text);
+            } else if (target == Type::DOUBLE) {
+                result.doubles_[i] = ValueData::parseDouble(text);
+            } else {
+                result.bools_[i] = ValueData::parseBool(text) ? 1 : 0;
+            }
+        }
+    }
+    return result;
+}
+
+void ValueColumn::resize(size_t size) {
+    size_ = size;
+    null_bits_.resize((size + 63) / 64, 0);
+    switch (type_) {
+        case Type::INTEGER:
+            ints_.resize(size);
+            break;
+        case Type::DOUBLE:
+            doubles_.resize(size);
+            break;
+        case Type::BOOLEAN:
+            bools_.resize(size);
+            break;
+        case Type::STRING:
+            string_offsets_.resize(size + 1, static_cast<uint32_t>(string_chars_.size()));
+            break;
+        default:
+            break;
+    }
+}
+
+void ValueColumn::combineNulls(const ValueColumn& a, const ValueColumn& b) {
+    for (size_t i = 0; i < null_bits_.size(); ++i) {
+        null_bits_[i] = a.null_bits_[i] | b.null_bits_[i];
+    }
+}
+
+ValueColumn ValueColumn::arithmetic(const ValueColumn& a, const ValueColumn& b, Operation operation) {
+    if (a.size_ != b.size_) {
+        return ValueColumn();
+    }
+    size_t size = a.size_;
+    
+    if (operation == Operation::ADD && (a.type_ == Type::STRING || b.type_ == Type::STRING)) {
+        return concatenate(a, b);
+    }
+    
+    if (a.type_ == Type::INTEGER && b.type_ == Type::INTEGER) {
+        ValueColumn result(Type::INTEGER);
+        result.resize(size);
+        result.combineNulls(a, b);
+        const int* x = a.ints_.data();
+        const int* y = b.ints_.data();
+        int* out = result.ints_.data();
+        switch (operation) {
+            case Operation::ADD:
+                binaryKernel(x, y, out, size, ValueData::addInts);
+                break;
+            case Operation::SUBTRACT:
+                binaryKernel(x, y, out, size, ValueData::subtractInts);
+                break;
+            case Operation::MULTIPLY:
+                binaryKernel(x, y, out, size, ValueData::multiplyInts);
+                break;
+            case Operation::DIVIDE:
+                binaryKernel(x, y, out, size, [](int p, int q) { return ValueData::divideInts(p, q != 0 ? q : 1); });
+                for (size_t i = 0; i < size; ++i) {
+                    if (y[i] == 0) {
+                        result.setNull(i);
+                    }
+                }
+                break;
+        }
+        return result;
+    }
+    
+    bool a_numeric = a.type_ == Type::INTEGER || a.type_ == Type::DOUBLE;
+    bool b_numeric = b.type_ == Type::INTEGER || b.type_ == Type::DOUBLE;
+    if (!a_numeric || !b_numeric) {
+        return nulls(Type::UNDEFINED, size);
+    }
+    
+    // Numeric mix promotes to double
+    ValueColumn left = a.type_ == Type::DOUBLE ? ValueColumn() : a.cast(Type::DOUBLE);
+    ValueColumn right = b.type_ == Type::DOUBLE ? ValueColumn() : b.cast(Type::DOUBLE);
+    const double* x = a.type_ == Type::DOUBLE ? a.doubles_.data() : left.doubles_.data();
+    const double* y = b.type_ == Type::DOUBLE ? b.doubles_.data() : right.doubles_.data();
+    
+    ValueColumn result(Type::DOUBLE);
+    result.resize(size);
+    result.combineNulls(a, b);
+    double* out = result.doubles_.data();
+    switch (operation) {
+        case Operation::ADD:
+            binaryKernel(x, y, out, size, [](double p, double q) { return p + q; });
+            break;
+        case Operation::SUBTRACT:
+            binaryKernel(x, y, out, size, [](double p, double q) { return p - q; });
+            break;
+        case Operation::MULTIPLY:
+            binaryKernel(x, y, out, size, [](double p, double q) { return p * q; });
+            break;
+        case Operation::DIVIDE:
+            binaryKernel(x, y, out, size, [](double p, double q) { return p / q; });
+            for (size_t i = 0; i < size; ++i) {
+                if (y[i] == 0.0) {
+                    result.setNull(i);
+                }
+            }
+            break;
+    }
+    return result;
+}
+
+ValueColumn ValueColumn::compare(const ValueColumn& a, const ValueColumn& b, Comparison comparison) {
+    if (a.size_ != b.size_) {
+        return ValueColumn();
+    }
+    size_t size = a.size_;
+    ValueColumn result(Type::BOOLEAN);
+    result.resize(size);
+    result.combineNulls(a, b);
+    uint8_t* out = result.bools_.data();
+    
+    auto run = [&](const auto* x, const auto* y) {
+        switch (comparison) {
+            case Comparison::EQUAL:
+                compareKernel(x, y, out, size, [](auto p, auto q) { return p == q; });
+                break;
+            case Comparison::NOT_EQUAL:
+                compareKernel(x, y, out, size, [](auto p, auto q) { return p != q; });
+                break;
+            case Comparison::LESS:
+                compareKernel(x, y, out, size, [](auto p, auto q) { return p < q; });
+                break;
+            case Comparison::GREATER:
+                compareKernel(x, y, out, size, [](auto p, auto q) { return p > q; });
+                break;
+        }
+    };
+    
+    bool a_numeric = a.type_ == Type::INTEGER || a.type_ == Type::DOUBLE;
+    bool b_numeric = b.type_ == Type::INTEGER || b.type_ == Type::DOUBLE;
+    bool equality = comparison == Comparison::EQUAL || comparison == Comparison::NOT_EQUAL;
+    
+    if (a.type_ == b.type_ && a.type_ == Type::INTEGER) {
+        run(a.ints_.data(), b.ints_.data());
+    } else if (a.type_ == b.type_ && a.type_ == Type::DOUBLE) {
+        run(a.doubles_.data(), b.doubles_.data());
+    } else if (a.type_ == b.type_ && a.type_ == Type::BOOLEAN) {
+        run(a.bools_.data(), b.bools_.data());
+    } else if (a_numeric && b_numeric && equality) {
+        // Value::equals compares an int/double pair as ints
+        ValueColumn left = a.cast(Type::INTEGER);
+        ValueColumn right = b.cast(Type::INTEGER);
+        run(left.ints_.data(), right.ints_.data());
+    } else if (a_numeric && b_numeric) {
+        ValueColumn left = a.cast(Type::DOUBLE);
+        ValueColumn right = b.cast(Type::DOUBLE);
+        run(left.doubles_.data(), right.doubles_.data());
+    } else if (a.type_ == b.type_ && a.type_ == Type::STRING) {
+        for (size_t i = 0; i < size; ++i) {
+            int order = a.stringAt(i).compare(b.stringAt(i));
+            switch (comparison) {
+                case Comparison::EQUAL: out[i] = order == 0; break;
+                case Comparison::NOT_EQUAL: out[i] = order != 0; break;
+                case Comparison::LESS: out[i] = order < 0; break;
+                case Comparison::GREATER: out[i] = order > 0; break;
+            }
+        }
+    } else if (equality && isColumnType(a.type_) && isColumnType(b.type_)) {
+        // Mixed types compare by their string form, as Value::equals does
+        ValueColumn left = a.cast(Type::STRING);
+        ValueColumn right = b.cast(Type::STRING);
+        for (size_t i = 0; i < size; ++i) {
+            bool same = left.stringAt(i) == right.stringAt(i);
+            out[i] = comparison == Comparison::EQUAL ? same : !same;
+        }
+    } else {
+        return nulls(Type::BOOLEAN, size);
+    }
+    return result;
+}
+
+ValueColumn ValueColumn::concatenate(const ValueColumn& a, const ValueColumn& b) {
+    ValueColumn left = a.cast(Type::STRING);
+    ValueColumn right = b.cast(Type::STRING);
+    size_t size = a.size_;
+    
+    ValueColumn result(Type::STRING);
+    result.string_chars_.reserve(left.string_chars_.size() + right.string_chars_.size());
+    result.resize(size);
+    result.combineNulls(a, b);
+    for (size_t i = 0; i < size; ++i) {
+        if (!result.isNull(i)) {
+            result.string_chars_.append(left.stringAt(i));
+            result.string_chars_.append(right.stringAt(i));
+        }
+        result.string_offsets_[i + 1] = static_cast<uint32_t>(result.string_chars_.size());
+    }
+    return result;
+}
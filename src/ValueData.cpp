@@ -0,0 +1,311 @@
+#include "../include/ValueData.h"
+#include <unordered_set>
+#include <mutex>
+#include <new>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+struct InternHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const { return std::hash<std::string_view>()(text); }
+};
+
+struct InternEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a == b; }
+};
+
+struct InternPool {
+    std::mutex mutex;
+    std::unordered_set<std::string, InternHash, InternEqual> strings;
+};
+
+InternPool& internPool() {
+    static InternPool* pool = new InternPool();  // Outlives every static ValueData
+    return *pool;
+}
+
+std::string_view numberText(std::string_view text) {
+    size_t start = 0;
+    while (start < text.size() && (text[start] == ' ' || (text[start] >= '\t' && text[start] <= '\r'))) {
+        ++start;
+    }
+    text.remove_prefix(start);
+    // from_chars rejects an explicit plus sign, stoi/stod accept one
+    if (text.size() > 1 && text[0] == '+' && text[1] != '-' && text[1] != '+') {
+        text.remove_prefix(1);
+    }
+    return text;
+}
+
+bool equalsIgnoreCase(std::string_view text, std::string_view lower) {
+    if (text.size() != lower.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        if (c != lower[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const std::string* StringInterner::intern(std::string_view text) {
+    InternPool& pool = internPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = pool.strings.find(text);
+    if (it == pool.strings.end()) {
+        it = pool.strings.emplace(text).first;
+    }
+    return &*it;
+}
+
+size_t StringInterner::getInternedCount() {
+    InternPool& pool = internPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.strings.size();
+}
+
+ValueData ValueData::fromString(std::string_view value) {
+    ValueData data;
+    data.type_ = Type::STRING;
+    if (value.size() <= INLINE_CAPACITY) {
+        std::memcpy(data.bytes_, value.data(), value.size());
+        data.length_ = static_cast<uint8_t>(value.size());
+    } else {
+        void* memory = ::operator new(sizeof(SharedString) + value.size());
+        SharedString* shared = new (memory) SharedString{{1}, value.size()};
+        std::memcpy(const_cast<char*>(shared->text()), value.data(), value.size());
+        std::memcpy(data.bytes_, &shared, sizeof(shared));
+        data.length_ = SHARED_LENGTH;
+    }
+    return data;
+}
+
+ValueData ValueData::fromInternedString(std::string_view value) {
+    if (value.size() <= INLINE_CAPACITY) {
+        return fromString(value);
+    }
+    ValueData data;
+    data.type_ = Type::STRING;
+    const std::string* interned = StringInterner::intern(value);
+    std::memcpy(data.bytes_, &interned, sizeof(interned));
+    data.length_ = INTERNED_LENGTH;
+    return data;
+}
+
+ValueData ValueData::fromStringView(std::string_view value) {
+    if (value.size() <= INLINE_CAPACITY || value.size() > UINT32_MAX) {
+        return fromString(value);
+    }
+    ValueData data;
+    data.type_ = Type::STRING;
+    const char* text = value.data();
+    uint32_t length = static_cast<uint32_t>(value.size());
+    std::memcpy(data.bytes_, &text, sizeof(text));
+    std::memcpy(data.bytes_ + sizeof(text), &length, sizeof(length));
+    data.length_ = VIEW_LENGTH;
+    return data;
+}
+
+void ValueData::releaseShared(SharedString* shared) {
+    if (shared->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        shared->~SharedString();
+        ::operator delete(shared);
+    }
+}
+
+std::string_view ValueData::asString() const {
+    if (type_ != Type::STRING) {
+        return std::string_view();
+    }
+    if (length_ == INTERNED_LENGTH) {
+        return *load<const std::string*>();
+    }
+    if (length_ == SHARED_LENGTH) {
+        const SharedString* shared = load<const SharedString*>();
+        return std::string_view(shared->text(), shared->length);
+    }
+    if (length_ == VIEW_LENGTH) {
+        uint32_t length;
+        std::memcpy(&length, bytes_ + sizeof(const char*), sizeof(length));
+        return std::string_view(load<const char*>(), length);
+    }
+    return std::string_view(bytes_, length_);
+}
+
+int ValueData::toInt() const {
+    switch (type_) {
+        case Type::INTEGER:
+            return asInt();
+        case Type::DOUBLE:
+            return static_cast<int>(asDouble());
+        case Type::BOOLEAN:
+            return asBool() ? 1 : 0;
+        case Type::STRING:
+            return parseInt(asString());
+        default:
+            return 0;
+    }
+}
+
+double ValueData::toDouble() const {
+    switch (type_) {
+        case Type::DOUBLE:
+            return asDouble();
+        case Type::INTEGER:
+            return static_cast<double>(asInt());
+        case Type::BOOLEAN:
+            return asBool() ? 1.0 : 0.0;
+        case Type::STRING:
+            return parseDouble(asString());
+        default:
+            return 0.0;
+    }
+}
+
+bool ValueData::toBool() const {
+    switch (type_) {
+        case Type::BOOLEAN:
+            return asBool();
+        case Type::INTEGER:
+            return asInt() != 0;
+        case Type::DOUBLE:
+            return asDouble() != 0.0;
+        case Type::STRING:
+            return parseBool(asString());
+        default:
+            return false;
+    }
+}
+
+std::string ValueData::toString() const {
+    std::string result;
+    appendTo(result);
+    return result;
+}
+
+void ValueData::appendTo(std::string& out) const {
+    // Large enough for any fixed-notation double (DBL_MAX has 309 digits)
+    char buffer[400];
+    std::to_chars_result result{buffer, std::errc()};
+    switch (type_) {
+        case Type::STRING:
+            out.append(asString());
+            return;
+        case Type::INTEGER:
+            result = std::to_chars(buffer, buffer + sizeof(buffer), asInt());
+            break;
+        case Type::DOUBLE:
+#if defined(__cpp_lib_to_chars)
+            // Same text as std::to_string: fixed notation, six decimals
+            result = std::to_chars(buffer, buffer + sizeof(buffer), asDouble(), std::chars_format::fixed, 6);
+#else
+            result.ptr = buffer + std::snprintf(buffer, sizeof(buffer), "%f", asDouble());
+#endif
+            break;
+        case Type::BOOLEAN:
+            out.append(asBool() ? "true" : "false");
+            return;
+        case Type::POINTER:
+            buffer[0] = '0';
+            buffer[1] = 'x';
+            result = std::to_chars(buffer + 2, buffer + sizeof(buffer),
+                                   reinterpret_cast<uintptr_t>(asPointer()), 16);
+            break;
+        default:
+            return;
+    }
+    if (result.ec == std::errc()) {
+        out.append(buffer, result.ptr);
+    }
+}
+
+int ValueData::parseInt(std::string_view text) {
+    text = numberText(text);
+    int value = 0;
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() ? value : 0;
+}
+
+double ValueData::parseDouble(std::string_view text) {
+    text = numberText(text);
+#if defined(__cpp_lib_to_chars)
+    double value = 0.0;
+    std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() ? value : 0.0;
+#else
+    // No floating-point from_chars in this standard library, strtod on a stack copy
+    char buffer[128];
+    size_t length = text.size() < sizeof(buffer) - 1 ? text.size() : sizeof(buffer) - 1;
+    std::memcpy(buffer, text.data(), length);
+    buffer[length] = '\0';
+    char* end = nullptr;
+    double value = std::strtod(buffer, &end);
+    return end != buffer ? value : 0.0;
+#endif
+}
+
+bool ValueData::parseBool(std::string_view text) {
+    return equalsIgnoreCase(text, "true") || text == "1" || equalsIgnoreCase(text, "yes");
+}
+
+ValueData ValueData::add(const ValueData& a, const ValueData& b) {
+    if (a.type_ == Type::INTEGER && b.type_ == Type::INTEGER) {
+        return fromInt(addInts(a.asInt(), b.asInt()));
+    } else if (a.isNumeric() && b.isNumeric()) {
+        return fromDouble(a.toDouble() + b.toDouble());
+    } else if (a.type_ == Type::STRING || b.type_ == Type::STRING) {
+        // Short results stay inline, no allocation
+        if (a.type_ == Type::STRING && b.type_ == Type::STRING) {
+            std::string_view left = a.asString();
+            std::string_view right = b.asString();
+            if (left.size() + right.size() <= INLINE_CAPACITY) {
+                char buffer[INLINE_CAPACITY];
+                std::memcpy(buffer, left.data(), left.size());
+                std::memcpy(buffer + left.size(), right.data(), right.size());
+                return fromString(std::string_view(buffer, left.size() + right.size()));
+            }
+        }
+        return fromString(a.toString() + b.toString());
+    }
+    return ValueData();
+}
+
+ValueData ValueData::subtract(const ValueData& a, const ValueData& b) {
+    if (a.type_ == Type::INTEGER && b.type_ == Type::INTEGER) {
+        return fromInt(subtractInts(a.asInt(), b.asInt()));
+    } else if (a.isNumeric() && b.isNumeric()) {
+        return fromDouble(a.toDouble() - b.toDouble());
+    }
+    return ValueData();
+}
+
+ValueData ValueData::multiply(const ValueData& a, const ValueData& b) {
+    if (a.type_ == Type::INTEGER && b.type_ == Type::INTEGER) {
+        return fromInt(multiplyInts(a.asInt(), b.asInt()));
+    } else if (a.isNumeric() && b.isNumeric()) {
+        return fromDouble(a.toDouble() * b.toDouble());
+    }
+    return ValueData();
+}
+
+ValueData ValueData::divide(const ValueData& a, const ValueData& b) {
+    if (a.type_ == Type::INTEGER && b.type_ == Type::INTEGER) {
+        int divisor = b.asInt();
+        return divisor != 0 ? fromInt(divideInts(a.asInt(), divisor)) : ValueData();
+    } else if (a.isNumeric() && b.isNumeric()) {
+        double divisor = b.toDouble();
+        return divisor != 0.0 ? fromDouble(a.toDouble() / divisor) : ValueData();
+    }
+    return ValueData();
+}
@@ -0,0 +1,131 @@
+#include "../include/SharedMemoryExchange.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Producer and consumer in two processes: the parent forks a consumer that
+// attaches to the segment and checks every batch in place while the parent
+// keeps the small ring full, so the ring wraps and pads many times.
+namespace {
+
+const size_t BATCH_COUNT = 5000;
+const size_t RING_CAPACITY = 64 * 1024;
+const auto TIMEOUT = std::chrono::seconds(30);
+
+// Batch sizes vary so records land at every offset of the ring
+size_t elementCount(size_t batch) {
+    return 1 + (batch * 37) % 1500;
+}
+
+double elementValue(size_t batch, size_t element) {
+    return static_cast<double>(batch) * 4096.0 + static_cast<double>(element);
+}
+
+int runConsumer(const std::string& name) {
+    SharedMemoryExchange consumer(name, SharedMemoryExchange::Role::CONSUMER);
+    if (!consumer.open()) {
+        std::cerr << "consumer: cannot attach to " << name << "\n";
+        return 1;
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+    size_t received = 0;
+    ShmBatchView view;
+    while (received < BATCH_COUNT) {
+        if (!consumer.peekBatch(view)) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                std::cerr << "consumer: timed out after " << received << " batches\n";
+                return 1;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        
+        const ShmBatchDescriptor& descriptor = *view.descriptor;
+        size_t count = elementCount(received);
+        if (descriptor.sequence != received || descriptor.element_count != count ||
+            descriptor.element_size != sizeof(double) ||
+            descriptor.kind != static_cast<uint32_t>(SharedMemoryExchange::BatchKind::POINTS_2D) ||
+            std::string(descriptor.data_type) != "points2d") {
+            std::cerr << "consumer: bad descriptor for batch " << received << "\n";
+            return 1;
+        }
+        const double* values = static_cast<const double*>(view.data);
+        for (size_t i = 0; i < count; ++i) {
+            if (values[i] != elementValue(received, i)) {
+                std::cerr << "consumer: bad element " << i << " in batch " << received << "\n";
+                return 1;
+            }
+        }
+        consumer.releaseBatch();
+        ++received;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    std::string name = "dsc_shm_test_" + std::to_string(::getpid());
+    
+    // Attaching before the producer created the segment must fail
+    SharedMemoryExchange early(name, SharedMemoryExchange::Role::CONSUMER);
+    if (early.open()) {
+        std::cerr << "consumer attached to a missing segment\n";
+        return 1;
+    }
+    
+    SharedMemoryExchange producer(name, SharedMemoryExchange::Role::PRODUCER, RING_CAPACITY);
+    if (!producer.open()) {
+        std::cerr << "producer: cannot create " << name << "\n";
+        return 1;
+    }
+    
+    pid_t child = ::fork();
+    if (child < 0) {
+        std::cerr << "fork failed\n";
+        return 1;
+    }
+    if (child == 0) {
+        ::_exit(runConsumer(name));
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+    std::vector<double> values;
+    bool timed_out = false;
+    for (size_t batch = 0; batch < BATCH_COUNT && !timed_out; ++batch) {
+        values.resize(elementCount(batch));
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = elementValue(batch, i);
+        }
+        // A full ring is expected, wait for the consumer
+        while (!producer.sendBatch(SharedMemoryExchange::BatchKind::POINTS_2D, "points2d", values.data(),
+                                   sizeof(double), values.size())) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                std::cerr << "producer: timed out at batch " << batch << "\n";
+                timed_out = true;
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+    
+    int status = 0;
+    if (timed_out) {
+        ::kill(child, SIGKILL);
+    }
+    ::waitpid(child, &status, 0);
+    producer.close();
+    
+    if (timed_out || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "shared memory exchange test failed\n";
+        return 1;
+    }
+    std::cout << "shared memory exchange: " << BATCH_COUNT << " batches across processes\n";
+    return 0;
+}